@@ -0,0 +1,143 @@
+#include "asset_file.h"
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool asset_file_open(asset_file_t* file, const std::string& path) {
+    asset_file_close(file);
+    file->path = path;
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        std::cerr << "Failed to get the size of " << path << std::endl;
+        CloseHandle(handle);
+        return false;
+    }
+
+    // A view can't be empty; the mapping handle may be closed once the
+    // view exists
+    if (size.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        if (!view) {
+            std::cerr << "Failed to map " << path << std::endl;
+            CloseHandle(handle);
+            return false;
+        }
+        file->data = static_cast<const uint8_t*>(view);
+        file->size = static_cast<size_t>(size.QuadPart);
+    }
+    CloseHandle(handle);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        std::cerr << "Failed to get the size of " << path << std::endl;
+        close(fd);
+        return false;
+    }
+
+    // mmap() can't map an empty file
+    if (st.st_size > 0) {
+        void* view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED) {
+            std::cerr << "Failed to map " << path << std::endl;
+            close(fd);
+            return false;
+        }
+        madvise(view, st.st_size, MADV_SEQUENTIAL);
+        file->data = static_cast<const uint8_t*>(view);
+        file->size = static_cast<size_t>(st.st_size);
+    }
+    close(fd);
+#endif
+    return true;
+}
+
+void asset_file_close(asset_file_t* file) {
+    if (file->data) {
+#ifdef _WIN32
+        UnmapViewOfFile(file->data);
+#else
+        munmap(const_cast<uint8_t*>(file->data), file->size);
+#endif
+    }
+    file->data = nullptr;
+    file->size = 0;
+}
+
+asset_reader_t asset_reader(const asset_file_t* file) {
+    return {file, 0, file->size, false};
+}
+
+bool asset_fail(asset_reader_t* r, const char* what) {
+    if (!r->failed) {
+        std::cerr << r->file->path << ": " << what << " at offset " << r->pos << std::endl;
+        r->failed = true;
+    }
+    return false;
+}
+
+const uint8_t* asset_take(asset_reader_t* r, size_t n, const char* what) {
+    if (r->failed) {
+        return nullptr;
+    }
+    if (n > r->end - r->pos) {
+        std::cerr << r->file->path << ": truncated " << what << " at offset " << r->pos
+                  << " (" << n << " bytes, " << r->end - r->pos << " left)" << std::endl;
+        r->failed = true;
+        return nullptr;
+    }
+    const uint8_t* data = r->file->data + r->pos;
+    r->pos += n;
+    return data;
+}
+
+bool asset_read_u8(asset_reader_t* r, uint8_t* value, const char* what) {
+    const uint8_t* data = asset_take(r, 1, what);
+    if (!data) {
+        return false;
+    }
+    *value = data[0];
+    return true;
+}
+
+bool asset_read_u16(asset_reader_t* r, uint16_t* value, const char* what) {
+    const uint8_t* data = asset_take(r, 2, what);
+    if (!data) {
+        return false;
+    }
+    *value = static_cast<uint16_t>(data[0] | (data[1] << 8));
+    return true;
+}
+
+bool asset_section(asset_reader_t* r, size_t n, const char* what, asset_reader_t* section) {
+    size_t start = r->pos;
+    if (!asset_take(r, n, what)) {
+        return false;
+    }
+    *section = {r->file, start, start + n, false};
+    return true;
+}
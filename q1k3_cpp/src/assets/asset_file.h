@@ -0,0 +1,47 @@
+#ifndef ASSET_FILE_H
+#define ASSET_FILE_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// Read-only asset container, mapped into memory. Parsers read the mapped
+// bytes directly through an asset_reader_t; nothing is copied.
+struct asset_file_t {
+    std::string path;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+bool asset_file_open(asset_file_t* file, const std::string& path);
+void asset_file_close(asset_file_t* file);
+
+// Bounds checked cursor over a range of a file. A read that doesn't fit
+// reports the file, offset and what was being read, and fails the reader:
+// all further reads fail too, so parsers only need to check where they
+// would otherwise go on with bad data.
+struct asset_reader_t {
+    const asset_file_t* file;
+    size_t pos;
+    size_t end;
+    bool failed;
+};
+
+asset_reader_t asset_reader(const asset_file_t* file);
+
+inline bool asset_done(const asset_reader_t* r) {
+    return r->failed || r->pos >= r->end;
+}
+
+// Next n bytes, valid as long as the file is open, or nullptr
+const uint8_t* asset_take(asset_reader_t* r, size_t n, const char* what);
+bool asset_read_u8(asset_reader_t* r, uint8_t* value, const char* what);
+bool asset_read_u16(asset_reader_t* r, uint16_t* value, const char* what);  // little endian
+
+// Reader over the next n bytes; r continues after them
+bool asset_section(asset_reader_t* r, size_t n, const char* what, asset_reader_t* section);
+
+// Report bad data at the reader's position and fail it; returns false
+bool asset_fail(asset_reader_t* r, const char* what);
+
+#endif // ASSET_FILE_H
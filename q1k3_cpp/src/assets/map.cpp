@@ -7,11 +7,17 @@
 #include "../game/entity_barrel.h"
 #include "../game/entity_torch.h"
 #include "../game/entity_trigger_level.h"
+#include "../game/nav.h"
 #include "../renderer/renderer.h"
+#include "asset_file.h"
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <cstring>
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 // Map size constant
 static const int MAP_SIZE = 128;
@@ -32,38 +38,32 @@ struct map_t {
     uint8_t* collision_map;  // Bitmap for collision
     std::vector<entity_data_t> entities;
     std::vector<std::pair<int, int>> render_blocks; // texture, vertex_offset
+    std::shared_ptr<nav_graph_t> nav;                // walkable floor for the AI
 };
 
 // Global map data
 static std::vector<map_t> maps;
-static map_t* current_map = nullptr;
 
 bool map_load_container(const std::string& path) {
     // Load all maps from container file
-    std::ifstream file(path + "l", std::ios::binary);
-    if (!file.is_open()) {
+    asset_file_t file;
+    if (!asset_file_open(&file, path + "l")) {
         std::cerr << "Failed to open map container: " << path << std::endl;
         return false;
     }
     
-    // Get file size
-    file.seekg(0, std::ios::end);
-    size_t file_size = file.tellg();
-    file.seekg(0, std::ios::beg);
-    
-    // Read entire file
-    std::vector<uint8_t> data(file_size);
-    file.read(reinterpret_cast<char*>(data.data()), file_size);
-    file.close();
-    
     // Parse maps
-    size_t i = 0;
-    while (i < data.size()) {
+    asset_reader_t r = asset_reader(&file);
+    while (!asset_done(&r)) {
         map_t map;
         
         // Read blocks size
-        uint16_t blocks_size = data[i] | (data[i + 1] << 8);
-        i += 2;
+        uint16_t blocks_size;
+        asset_reader_t blocks;
+        if (!asset_read_u16(&r, &blocks_size, "map blocks size") ||
+            !asset_section(&r, blocks_size, "map blocks", &blocks)) {
+            break;
+        }
         
         // Allocate collision map (bitmap)
         size_t cm_size = (MAP_SIZE * MAP_SIZE * MAP_SIZE) >> 3;
@@ -71,25 +71,37 @@ bool map_load_container(const std::string& path) {
         std::memset(map.collision_map, 0, cm_size);
         
         // Parse blocks
-        size_t blocks_end = i + blocks_size;
         int current_texture = 0;
         
-        while (i < blocks_end) {
+        while (!asset_done(&blocks)) {
             // Check for texture sentinel
-            if (data[i] == 255) {
-                i++;
-                current_texture = data[i++];
+            uint8_t first;
+            asset_read_u8(&blocks, &first, "map block");
+            if (first == 255) {
+                uint8_t texture;
+                if (asset_read_u8(&blocks, &texture, "map block texture")) {
+                    current_texture = texture;
+                }
                 continue;
             }
             
             // Read block data
+            const uint8_t* data = asset_take(&blocks, 5, "map block");
+            if (!data) {
+                break;
+            }
             block_t block;
-            block.x = data[i++];
-            block.y = data[i++];
-            block.z = data[i++];
-            block.sx = data[i++];
-            block.sy = data[i++];
-            block.sz = data[i++];
+            block.x = first;
+            block.y = data[0];
+            block.z = data[1];
+            block.sx = data[2];
+            block.sy = data[3];
+            block.sz = data[4];
+            if (block.x + block.sx > MAP_SIZE || block.y + block.sy > MAP_SIZE ||
+                block.z + block.sz > MAP_SIZE) {
+                asset_fail(&blocks, "map block outside the map");
+                break;
+            }
             
             // Add block to renderer
             int vertex_offset = r_push_block(
@@ -111,23 +123,38 @@ bool map_load_container(const std::string& path) {
             }
         }
         
-        // Read entities
-        uint16_t num_entities = data[i] | (data[i + 1] << 8);
-        i += 2;
+        // Read entities, 6 bytes each
+        uint16_t num_entities = 0;
+        const uint8_t* data = nullptr;
+        if (!blocks.failed && asset_read_u16(&r, &num_entities, "map entity count")) {
+            data = asset_take(&r, num_entities * 6, "map entities");
+        }
+        if (!data) {
+            delete[] map.collision_map;
+            r.failed = true;
+            break;
+        }
         
-        for (int e = 0; e < num_entities; e++) {
+        for (int e = 0; e < num_entities; e++, data += 6) {
             entity_data_t entity;
-            entity.type = data[i++];
-            entity.x = data[i++];
-            entity.y = data[i++];
-            entity.z = data[i++];
-            entity.data1 = data[i++];
-            entity.data2 = data[i++];
+            entity.type = data[0];
+            entity.x = data[1];
+            entity.y = data[2];
+            entity.z = data[3];
+            entity.data1 = data[4];
+            entity.data2 = data[5];
             map.entities.push_back(entity);
         }
         
+        map.nav = nav_build(&map);
         maps.push_back(map);
     }
+    asset_file_close(&file);
+    
+    if (r.failed) {
+        std::cerr << "Failed to load maps" << std::endl;
+        return false;
+    }
     
     // Submit vertex buffer to renderer
     r_submit_buffer();
@@ -136,34 +163,38 @@ bool map_load_container(const std::string& path) {
     return true;
 }
 
-void map_init(int index) {
+int map_count() {
+    return static_cast<int>(maps.size());
+}
+
+void map_init(game_context_t* ctx, int index) {
     if (index >= maps.size()) {
         std::cerr << "Invalid map index: " << index << std::endl;
         return;
     }
     
-    current_map = &maps[index];
+    ctx->map = &maps[index];
     
     // Entity spawn table - must match map_packer.c
-    typedef EntityPtr (*spawn_func_t)(const vec3&, void*, void*);
+    typedef EntityPtr (*spawn_func_t)(game_context_t*, const vec3&, void*, void*);
     
     // Define spawn functions
-    static spawn_func_t spawn_player = [](const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_player_t>(p, d1, d2); };
-    static spawn_func_t spawn_grunt = [](const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_enemy_grunt_t>(p, d1, d2); };
-    static spawn_func_t spawn_enforcer = [](const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_enemy_enforcer_t>(p, d1, d2); };
-    static spawn_func_t spawn_ogre = [](const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_enemy_ogre_t>(p, d1, d2); };
-    static spawn_func_t spawn_zombie = [](const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_enemy_zombie_t>(p, d1, d2); };
-    static spawn_func_t spawn_hound = [](const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_enemy_hound_t>(p, d1, d2); };
-    static spawn_func_t spawn_health = [](const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_pickup_health_t>(p, d1, d2); };
-    static spawn_func_t spawn_nailgun = [](const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_pickup_nailgun_t>(p, d1, d2); };
-    static spawn_func_t spawn_grenadelauncher = [](const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_pickup_grenadelauncher_t>(p, d1, d2); };
-    static spawn_func_t spawn_nails = [](const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_pickup_nails_t>(p, d1, d2); };
-    static spawn_func_t spawn_grenades = [](const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_pickup_grenades_t>(p, d1, d2); };
-    static spawn_func_t spawn_key = [](const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_pickup_key_t>(p, d1, d2); };
-    static spawn_func_t spawn_door = [](const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_door_t>(p, d1, d2); };
-    static spawn_func_t spawn_barrel = [](const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_barrel_t>(p, d1, d2); };
-    static spawn_func_t spawn_torch = [](const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_torch_t>(p, d1, d2); };
-    static spawn_func_t spawn_trigger_level = [](const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_trigger_level_t>(p, d1, d2); };
+    static spawn_func_t spawn_player = [](game_context_t* ctx, const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_player_t>(ctx, p, d1, d2); };
+    static spawn_func_t spawn_grunt = [](game_context_t* ctx, const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_enemy_grunt_t>(ctx, p, d1, d2); };
+    static spawn_func_t spawn_enforcer = [](game_context_t* ctx, const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_enemy_enforcer_t>(ctx, p, d1, d2); };
+    static spawn_func_t spawn_ogre = [](game_context_t* ctx, const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_enemy_ogre_t>(ctx, p, d1, d2); };
+    static spawn_func_t spawn_zombie = [](game_context_t* ctx, const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_enemy_zombie_t>(ctx, p, d1, d2); };
+    static spawn_func_t spawn_hound = [](game_context_t* ctx, const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_enemy_hound_t>(ctx, p, d1, d2); };
+    static spawn_func_t spawn_health = [](game_context_t* ctx, const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_pickup_health_t>(ctx, p, d1, d2); };
+    static spawn_func_t spawn_nailgun = [](game_context_t* ctx, const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_pickup_nailgun_t>(ctx, p, d1, d2); };
+    static spawn_func_t spawn_grenadelauncher = [](game_context_t* ctx, const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_pickup_grenadelauncher_t>(ctx, p, d1, d2); };
+    static spawn_func_t spawn_nails = [](game_context_t* ctx, const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_pickup_nails_t>(ctx, p, d1, d2); };
+    static spawn_func_t spawn_grenades = [](game_context_t* ctx, const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_pickup_grenades_t>(ctx, p, d1, d2); };
+    static spawn_func_t spawn_key = [](game_context_t* ctx, const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_pickup_key_t>(ctx, p, d1, d2); };
+    static spawn_func_t spawn_door = [](game_context_t* ctx, const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_door_t>(ctx, p, d1, d2); };
+    static spawn_func_t spawn_barrel = [](game_context_t* ctx, const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_barrel_t>(ctx, p, d1, d2); };
+    static spawn_func_t spawn_torch = [](game_context_t* ctx, const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_torch_t>(ctx, p, d1, d2); };
+    static spawn_func_t spawn_trigger_level = [](game_context_t* ctx, const vec3& p, void* d1, void* d2) -> EntityPtr { return game_spawn<entity_trigger_level_t>(ctx, p, d1, d2); };
     
     spawn_func_t spawn_table[] = {
         /* 00 */ spawn_player,
@@ -185,35 +216,35 @@ void map_init(int index) {
     };
     
     // Spawn all entities
-    for (const auto& entity : current_map->entities) {
+    for (const auto& entity : ctx->map->entities) {
         if (entity.type < sizeof(spawn_table) / sizeof(spawn_table[0])) {
             vec3 pos(entity.x << 5, entity.y << 4, entity.z << 5);
-            spawn_table[entity.type](pos, const_cast<uint8_t*>(&entity.data1), const_cast<uint8_t*>(&entity.data2));
+            spawn_table[entity.type](ctx, pos, const_cast<uint8_t*>(&entity.data1), const_cast<uint8_t*>(&entity.data2));
         }
     }
 }
 
-void map_draw() {
-    if (!current_map) return;
+void map_draw(const map_t* map) {
+    if (!map) return;
     
     // Draw all blocks
-    for (const auto& block : current_map->render_blocks) {
+    for (const auto& block : map->render_blocks) {
         // The renderer will handle batching by texture
-        r_draw(vec3(), 0, 0, block.first, block.second, block.second, 0, 36); // 36 verts per block
+        r_draw(vec3(), 0, 0, block.first, block.second, 36); // 36 verts per block
     }
 }
 
-bool map_block_at(int x, int y, int z) {
-    if (!current_map || x < 0 || y < 0 || z < 0 || 
+bool map_block_at(const map_t* map, int x, int y, int z) {
+    if (!map || x < 0 || y < 0 || z < 0 || 
         x >= MAP_SIZE || y >= MAP_SIZE || z >= MAP_SIZE) {
         return true; // Out of bounds = solid
     }
     
     int bit_index = z * MAP_SIZE * MAP_SIZE + y * MAP_SIZE + x;
-    return (current_map->collision_map[bit_index >> 3] & (1 << (x & 7))) != 0;
+    return (map->collision_map[bit_index >> 3] & (1 << (x & 7))) != 0;
 }
 
-bool map_block_at_box(const vec3& min, const vec3& max) {
+bool map_block_at_box(const map_t* map, const vec3& min, const vec3& max) {
     // Check all blocks that the box intersects
     int x0 = static_cast<int>(min.x) >> 5;
     int y0 = static_cast<int>(min.y) >> 4;
@@ -225,7 +256,7 @@ bool map_block_at_box(const vec3& min, const vec3& max) {
     for (int z = z0; z <= z1; z++) {
         for (int y = y0; y <= y1; y++) {
             for (int x = x0; x <= x1; x++) {
-                if (map_block_at(x, y, z)) {
+                if (map_block_at(map, x, y, z)) {
                     return true;
                 }
             }
@@ -235,7 +266,105 @@ bool map_block_at_box(const vec3& min, const vec3& max) {
     return false;
 }
 
-bool map_trace(const vec3& from, const vec3& to) {
+void map_overlay_clear(map_overlay_t* overlay) {
+    overlay->bits.assign((MAP_SIZE * MAP_SIZE * MAP_SIZE) >> 3, 0);
+    overlay->counts.clear();
+    overlay->version++;
+}
+
+bool map_overlay_at(const map_overlay_t* overlay, int x, int y, int z) {
+    if (overlay->counts.empty() || x < 0 || y < 0 || z < 0 ||
+        x >= MAP_SIZE || y >= MAP_SIZE || z >= MAP_SIZE) {
+        return false;
+    }
+    int bit_index = z * MAP_SIZE * MAP_SIZE + y * MAP_SIZE + x;
+    return (overlay->bits[bit_index >> 3] & (1 << (x & 7))) != 0;
+}
+
+static void map_overlay_stamp(map_overlay_t* overlay, const map_mover_t& cells, int delta) {
+    if (overlay->bits.empty()) {
+        map_overlay_clear(overlay);
+    }
+    for (int z = std::max(cells.z0, 0); z <= std::min(cells.z1, MAP_SIZE - 1); z++) {
+        for (int y = std::max(cells.y0, 0); y <= std::min(cells.y1, MAP_SIZE - 1); y++) {
+            for (int x = std::max(cells.x0, 0); x <= std::min(cells.x1, MAP_SIZE - 1); x++) {
+                uint32_t bit_index = z * MAP_SIZE * MAP_SIZE + y * MAP_SIZE + x;
+                uint8_t& count = overlay->counts[bit_index];
+                count += delta;
+                if (count) {
+                    overlay->bits[bit_index >> 3] |= 1 << (x & 7);
+                } else {
+                    overlay->bits[bit_index >> 3] &= ~(1 << (x & 7));
+                    overlay->counts.erase(bit_index);
+                }
+            }
+        }
+    }
+    overlay->version++;
+}
+
+void map_mover_move(map_overlay_t* overlay, map_mover_t* mover, const vec3& min, const vec3& max) {
+    // Cells the box overlaps; a box ending exactly on a cell border
+    // doesn't reach into the next one
+    map_mover_t cells;
+    cells.x0 = static_cast<int>(std::floor(min.x / 32));
+    cells.y0 = static_cast<int>(std::floor(min.y / 16));
+    cells.z0 = static_cast<int>(std::floor(min.z / 32));
+    cells.x1 = static_cast<int>(std::ceil(max.x / 32)) - 1;
+    cells.y1 = static_cast<int>(std::ceil(max.y / 16)) - 1;
+    cells.z1 = static_cast<int>(std::ceil(max.z / 32)) - 1;
+    
+    if (cells.x0 == mover->x0 && cells.y0 == mover->y0 && cells.z0 == mover->z0 &&
+        cells.x1 == mover->x1 && cells.y1 == mover->y1 && cells.z1 == mover->z1) {
+        return;
+    }
+    
+    map_overlay_stamp(overlay, *mover, -1);
+    map_overlay_stamp(overlay, cells, 1);
+    *mover = cells;
+}
+
+void map_mover_remove(map_overlay_t* overlay, map_mover_t* mover) {
+    map_overlay_stamp(overlay, *mover, -1);
+    *mover = map_mover_t();
+}
+
+bool map_solid_at(const game_context_t* ctx, int x, int y, int z) {
+    return map_block_at(ctx->map, x, y, z) || map_overlay_at(&ctx->overlay, x, y, z);
+}
+
+bool map_solid_at_box(const game_context_t* ctx, const vec3& min, const vec3& max) {
+    if (map_block_at_box(ctx->map, min, max)) {
+        return true;
+    }
+    if (ctx->overlay.counts.empty()) {
+        return false;
+    }
+    
+    int x0 = static_cast<int>(min.x) >> 5;
+    int y0 = static_cast<int>(min.y) >> 4;
+    int z0 = static_cast<int>(min.z) >> 5;
+    int x1 = static_cast<int>(max.x) >> 5;
+    int y1 = static_cast<int>(max.y) >> 4;
+    int z1 = static_cast<int>(max.z) >> 5;
+    
+    for (int z = z0; z <= z1; z++) {
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                if (map_overlay_at(&ctx->overlay, x, y, z)) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+const nav_graph_t* map_nav(const map_t* map) {
+    return map ? map->nav.get() : nullptr;
+}
+
+bool map_trace(const map_t* map, const vec3& from, const vec3& to) {
     // Simple line trace for line of sight
     vec3 dir = to - from;
     float len = vec3_length(dir);
@@ -243,10 +372,77 @@ bool map_trace(const vec3& from, const vec3& to) {
     
     for (float t = 0; t < len; t += 16) {
         vec3 pos = from + dir * t;
-        if (map_block_at(pos.x / 32, pos.y / 16, pos.z / 32)) {
+        if (map_block_at(map, pos.x / 32, pos.y / 16, pos.z / 32)) {
             return true;
         }
     }
     
     return false;
-}
\ No newline at end of file
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+// Steps 4 rays in lockstep: sample positions and block coordinates are
+// computed with SSE2 in the same operation order as map_trace(), so the
+// results are identical; the bitmap lookups themselves stay scalar.
+void map_trace_batch(const map_t* map, const vec3* from, const vec3* to,
+                     int count, uint8_t* blocked) {
+    for (int base = 0; base < count; base += 4) {
+        int lanes = std::min(4, count - base);
+        alignas(16) float fx[4] = {0}, fy[4] = {0}, fz[4] = {0};
+        alignas(16) float dx[4] = {0}, dy[4] = {0}, dz[4] = {0};
+        float len[4] = {0};
+        bool done[4] = {true, true, true, true};
+        
+        for (int l = 0; l < lanes; l++) {
+            vec3 dir = to[base + l] - from[base + l];
+            len[l] = vec3_length(dir);
+            dir = vec3_normalize(dir);
+            fx[l] = from[base + l].x;
+            fy[l] = from[base + l].y;
+            fz[l] = from[base + l].z;
+            dx[l] = dir.x;
+            dy[l] = dir.y;
+            dz[l] = dir.z;
+            blocked[base + l] = false;
+            done[l] = false;
+        }
+        
+        const __m128 fx4 = _mm_load_ps(fx), fy4 = _mm_load_ps(fy), fz4 = _mm_load_ps(fz);
+        const __m128 dx4 = _mm_load_ps(dx), dy4 = _mm_load_ps(dy), dz4 = _mm_load_ps(dz);
+        const __m128 v32 = _mm_set1_ps(32), v16 = _mm_set1_ps(16);
+        int remaining = lanes;
+        
+        for (float t = 0; remaining; t += 16) {
+            __m128 t4 = _mm_set1_ps(t);
+            alignas(16) int bx[4], by[4], bz[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(bx), _mm_cvttps_epi32(
+                _mm_div_ps(_mm_add_ps(fx4, _mm_mul_ps(dx4, t4)), v32)));
+            _mm_store_si128(reinterpret_cast<__m128i*>(by), _mm_cvttps_epi32(
+                _mm_div_ps(_mm_add_ps(fy4, _mm_mul_ps(dy4, t4)), v16)));
+            _mm_store_si128(reinterpret_cast<__m128i*>(bz), _mm_cvttps_epi32(
+                _mm_div_ps(_mm_add_ps(fz4, _mm_mul_ps(dz4, t4)), v32)));
+            
+            for (int l = 0; l < lanes; l++) {
+                if (done[l]) {
+                    continue;
+                }
+                if (t >= len[l]) {
+                    done[l] = true;
+                    remaining--;
+                } else if (map_block_at(map, bx[l], by[l], bz[l])) {
+                    blocked[base + l] = true;
+                    done[l] = true;
+                    remaining--;
+                }
+            }
+        }
+    }
+}
+#else
+void map_trace_batch(const map_t* map, const vec3* from, const vec3* to,
+                     int count, uint8_t* blocked) {
+    for (int i = 0; i < count; i++) {
+        blocked[i] = map_trace(map, from[i], to[i]);
+    }
+}
+#endif
@@ -2,14 +2,58 @@
 #define MAP_H
 
 #include <string>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
 #include "../core/vec3.h"
 
-// Map functions
+struct map_t;
+struct game_context_t;
+struct nav_graph_t;
+
+// Map functions. Loaded maps are shared and never modified; every game
+// context points at the one it is playing.
 bool map_load_container(const std::string& path);
-void map_init(int index);
-void map_draw();
-bool map_block_at(int x, int y, int z);
-bool map_block_at_box(const vec3& min, const vec3& max);
-bool map_trace(const vec3& from, const vec3& to);
+int map_count();
+void map_init(game_context_t* ctx, int index);
+void map_draw(const map_t* map);
+bool map_block_at(const map_t* map, int x, int y, int z);
+bool map_block_at_box(const map_t* map, const vec3& min, const vec3& max);
+bool map_trace(const map_t* map, const vec3& from, const vec3& to);
+const nav_graph_t* map_nav(const map_t* map);
+
+// Solid cells of moving geometry (doors) on top of a map's static
+// collision map, one per game context. Movers stamp the cells they cover
+// and clear them again when they move on; cells covered by several movers
+// are counted. version changes whenever a cell changes, so caches built on
+// the grid (nav) know when to rebuild.
+struct map_overlay_t {
+    std::vector<uint8_t> bits;                    // same layout as collision_map
+    std::unordered_map<uint32_t, uint8_t> counts; // movers covering each set cell
+    uint32_t version = 0;
+};
+
+// Cells covered by one mover, inclusive
+struct map_mover_t {
+    int x0 = 0, y0 = 0, z0 = 0;
+    int x1 = -1, y1 = -1, z1 = -1;
+};
+
+void map_overlay_clear(map_overlay_t* overlay);
+bool map_overlay_at(const map_overlay_t* overlay, int x, int y, int z);
+
+// Stamp the box min..max for the mover, clearing the cells it covered
+// before. Does nothing if it still covers the same cells.
+void map_mover_move(map_overlay_t* overlay, map_mover_t* mover, const vec3& min, const vec3& max);
+void map_mover_remove(map_overlay_t* overlay, map_mover_t* mover);
+
+// Static map and the context's overlay combined; used for entity movement
+bool map_solid_at(const game_context_t* ctx, int x, int y, int z);
+bool map_solid_at_box(const game_context_t* ctx, const vec3& min, const vec3& max);
+
+// map_trace() for count rays at once; blocked[i] is set to the result of
+// map_trace(map, from[i], to[i])
+void map_trace_batch(const map_t* map, const vec3* from, const vec3* to,
+                     int count, uint8_t* blocked);
 
 #endif // MAP_H
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "jobs.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+struct job_t {
+    const job_func_t* fn;
+    int begin, end;
+};
+
+struct job_queue_t {
+    std::mutex mutex;
+    std::deque<job_t> jobs;
+};
+
+// Queue 0 belongs to the thread calling jobs_parallel_for
+static std::vector<std::unique_ptr<job_queue_t>> job_queues;
+static std::vector<std::thread> job_workers;
+static std::mutex job_wake_mutex;
+static std::condition_variable job_wake;
+static std::atomic<int> job_pending(0);   // jobs not yet finished
+static std::atomic<int> job_queued(0);    // jobs not yet picked up
+static std::atomic<bool> job_quit(false);
+static std::atomic<bool> job_busy(false);   // a jobs_parallel_for is running
+
+// Set on the worker threads; parallel_for calls from inside a job run inline
+static thread_local bool job_is_worker = false;
+
+// Own queue is worked from the back, others are stolen from the front
+static bool job_pop(int queue, job_t& job) {
+    job_queue_t& own = *job_queues[queue];
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = own.jobs.back();
+            own.jobs.pop_back();
+            job_queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    int n = static_cast<int>(job_queues.size());
+    for (int i = 1; i < n; i++) {
+        job_queue_t& other = *job_queues[(queue + i) % n];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.jobs.empty()) {
+            job = other.jobs.front();
+            other.jobs.pop_front();
+            job_queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void job_run(const job_t& job) {
+    (*job.fn)(job.begin, job.end);
+    job_pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+static void job_worker_main(int queue) {
+    job_is_worker = true;
+    while (true) {
+        job_t job;
+        if (job_pop(queue, job)) {
+            job_run(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(job_wake_mutex);
+        job_wake.wait(lock, [] { return job_quit.load() || job_queued.load() > 0; });
+        if (job_quit.load()) {
+            return;
+        }
+    }
+}
+
+void jobs_init(int num_threads) {
+    jobs_shutdown();
+
+    if (num_threads <= 0) {
+        num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+
+    job_quit = false;
+    for (int i = 0; i < num_threads; i++) {
+        job_queues.push_back(std::make_unique<job_queue_t>());
+    }
+    for (int i = 1; i < num_threads; i++) {
+        job_workers.emplace_back(job_worker_main, i);
+    }
+}
+
+void jobs_shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(job_wake_mutex);
+        job_quit = true;
+    }
+    job_wake.notify_all();
+
+    for (auto& worker : job_workers) {
+        worker.join();
+    }
+    job_workers.clear();
+    job_queues.clear();
+}
+
+int jobs_num_threads() {
+    return std::max(1, static_cast<int>(job_queues.size()));
+}
+
+void jobs_parallel_for(int count, int grain, const job_func_t& fn) {
+    if (count <= 0) {
+        return;
+    }
+    grain = std::max(1, grain);
+
+    // Nothing to distribute, or called from inside a job (e.g. one world's
+    // update while many worlds are stepped in parallel); run inline
+    if (job_workers.empty() || count <= grain || job_is_worker ||
+        job_busy.exchange(true, std::memory_order_acquire)) {
+        fn(0, count);
+        return;
+    }
+
+    // Deal the chunks out round-robin, then help until everything is done
+    int n = static_cast<int>(job_queues.size());
+    int chunks = (count + grain - 1) / grain;
+    job_pending.fetch_add(chunks, std::memory_order_acq_rel);
+    for (int c = 0; c < chunks; c++) {
+        job_queue_t& queue = *job_queues[c % n];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back({&fn, c * grain, std::min(count, (c + 1) * grain)});
+        job_queued.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Taking the mutex makes sure no worker is between checking for work
+    // and going to sleep, so the wakeup can't get lost
+    {
+        std::lock_guard<std::mutex> lock(job_wake_mutex);
+    }
+    job_wake.notify_all();
+
+    while (job_pending.load(std::memory_order_acquire) > 0) {
+        job_t job;
+        if (job_pop(0, job)) {
+            job_run(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    job_busy.store(false, std::memory_order_release);
+}
@@ -0,0 +1,22 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <functional>
+
+// Work-stealing job system. Every thread (including the caller) owns a queue
+// of jobs; idle threads steal from the others. jobs_parallel_for() blocks
+// until all of its jobs are done, with the calling thread helping out.
+
+using job_func_t = std::function<void(int begin, int end)>;
+
+// Start the worker threads. num_threads counts the calling thread, so 1 runs
+// everything inline; 0 uses the number of hardware threads.
+void jobs_init(int num_threads = 0);
+void jobs_shutdown();
+int jobs_num_threads();
+
+// Call fn over [0, count) split into chunks of at most grain items. Nested
+// or concurrent calls don't wait for each other; they run inline.
+void jobs_parallel_for(int count, int grain, const job_func_t& fn);
+
+#endif // JOBS_H
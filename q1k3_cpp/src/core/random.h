@@ -0,0 +1,67 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+// xoshiro128+ random streams. A stream is 16 bytes of state and only ever
+// used by one thread at a time; anything that needs random numbers owns
+// one (the game context, each entity, each generated texture). Streams are
+// seeded from a master seed and a stream id through splitmix64, so any
+// number of them can be derived from one seed without overlapping, and the
+// same seed always gives the same numbers regardless of threading.
+struct random_t {
+    uint32_t s[4];
+};
+
+inline uint64_t random_splitmix64(uint64_t& x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+inline void random_seed(random_t* r, uint64_t seed, uint64_t stream) {
+    uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ull);
+    uint64_t a = random_splitmix64(x);
+    uint64_t b = random_splitmix64(x);
+    r->s[0] = static_cast<uint32_t>(a);
+    r->s[1] = static_cast<uint32_t>(a >> 32);
+    r->s[2] = static_cast<uint32_t>(b);
+    r->s[3] = static_cast<uint32_t>(b >> 32);
+    
+    // The all zero state never leaves zero
+    if (!(r->s[0] | r->s[1] | r->s[2] | r->s[3])) {
+        r->s[0] = 1;
+    }
+}
+
+inline uint32_t random_u32(random_t* r) {
+    uint32_t* s = r->s;
+    uint32_t result = s[0] + s[3];
+    uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 11) | (s[3] >> 21);
+    return result;
+}
+
+// [0, 1) with all 24 bits of float precision; the low bits of xoshiro128+
+// are the weak ones and are dropped
+inline float random_float(random_t* r) {
+    return (random_u32(r) >> 8) * (1.0f / 16777216.0f);
+}
+
+// [min, max)
+inline float random_range(random_t* r, float min, float max) {
+    return min + (max - min) * random_float(r);
+}
+
+// [0, n)
+inline int random_int(random_t* r, int n) {
+    return static_cast<int>((static_cast<uint64_t>(random_u32(r)) * static_cast<uint32_t>(n)) >> 32);
+}
+
+#endif // RANDOM_H
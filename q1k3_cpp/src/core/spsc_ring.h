@@ -0,0 +1,73 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+// Wait-free ring buffer for exactly one producer and one consumer thread.
+// push() and pop() never block or allocate; push() fails when the ring is
+// full. N must be a power of two.
+template<typename T, uint32_t N>
+class spsc_ring_t {
+    static_assert(N && !(N & (N - 1)), "spsc_ring_t size must be a power of two");
+    
+    T items[N];
+    
+    // Written by the producer / consumer only; on separate cache lines so
+    // the two threads don't fight over them
+    alignas(64) std::atomic<uint32_t> tail{0};
+    alignas(64) std::atomic<uint32_t> head{0};
+    
+public:
+    // Producer
+    bool push(const T& item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        items[t & (N - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Consumer
+    bool pop(T& item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[h & (N - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Bulk versions for streams of samples: copy as many items as there
+    // are room for / as there are, and return how many that was
+    uint32_t push(const T* src, uint32_t count) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t n = std::min(count, N - (t - head.load(std::memory_order_acquire)));
+        for (uint32_t i = 0; i < n; i++) {
+            items[(t + i) & (N - 1)] = src[i];
+        }
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+    
+    uint32_t pop(T* dst, uint32_t count) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t n = std::min(count, tail.load(std::memory_order_acquire) - h);
+        for (uint32_t i = 0; i < n; i++) {
+            dst[i] = items[(h + i) & (N - 1)];
+        }
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+    
+    // Producer: number of items push() would accept right now
+    uint32_t space() const {
+        return N - (tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire));
+    }
+};
+
+#endif // SPSC_RING_H
@@ -18,8 +18,30 @@ struct vec3 {
     vec3& operator*=(float b) { x *= b; y *= b; z *= b; return *this; }
 };
 
+// View onto a vec3 whose components live elsewhere, e.g. in the
+// structure-of-arrays physics storage. Reads and writes go straight through.
+struct vec3_ref {
+    float &x, &y, &z;
+    
+    vec3_ref(float& x, float& y, float& z) : x(x), y(y), z(z) {}
+    vec3_ref(const vec3_ref&) = default;
+    
+    operator vec3() const { return vec3(x, y, z); }
+    vec3_ref& operator=(const vec3& b) { x = b.x; y = b.y; z = b.z; return *this; }
+    vec3_ref& operator=(const vec3_ref& b) { return *this = vec3(b); }
+    
+    vec3 operator+(const vec3& b) const { return vec3(x + b.x, y + b.y, z + b.z); }
+    vec3 operator-(const vec3& b) const { return vec3(x - b.x, y - b.y, z - b.z); }
+    vec3 operator*(const vec3& b) const { return vec3(x * b.x, y * b.y, z * b.z); }
+    vec3 operator*(float b) const { return vec3(x * b, y * b, z * b); }
+    
+    vec3_ref& operator+=(const vec3& b) { x += b.x; y += b.y; z += b.z; return *this; }
+    vec3_ref& operator-=(const vec3& b) { x -= b.x; y -= b.y; z -= b.z; return *this; }
+    vec3_ref& operator*=(float b) { x *= b; y *= b; z *= b; return *this; }
+};
+
 inline vec3 vec3_clone(const vec3& a) { return vec3(a.x, a.y, a.z); }
-inline float vec3_length(const vec3& a) { return std::hypot(std::hypot(a.x, a.y), a.z); }
+inline float vec3_length(const vec3& a) { return std::sqrt(a.x * a.x + a.y * a.y + a.z * a.z); }
 inline float vec3_dist(const vec3& a, const vec3& b) { return vec3_length(a - b); }
 inline float vec3_dot(const vec3& a, const vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
 inline vec3 vec3_add(const vec3& a, const vec3& b) { return a + b; }
@@ -0,0 +1,70 @@
+#include "activity.h"
+#include "entity.h"
+#include "entity_player.h"
+
+void activity_update(game_context_t* ctx) {
+    // No one to be near of (dead, end screen): everything that isn't at
+    // rest stays active
+    bool has_player = ctx->entity_player && !ctx->entity_player->_dead;
+    vec3 player_pos = has_player ? vec3(ctx->entity_player->p) : vec3();
+    
+    const float reduced_sq = ACTIVITY_REDUCED_DIST * ACTIVITY_REDUCED_DIST;
+    const float dormant_sq = ACTIVITY_DORMANT_DIST * ACTIVITY_DORMANT_DIST;
+    
+    for (auto& entity : ctx->entities) {
+        if (!entity->_activity_lod || entity->_dead) {
+            continue;
+        }
+        
+        if (entity->_awake_until > ctx->time) {
+            entity->_activity = ENTITY_ACTIVE;
+        } else if (entity->_at_rest()) {
+            // Things lying around don't need an update until something
+            // happens to them (damage, noise, a trigger)
+            entity->_activity = ENTITY_DORMANT;
+        } else if (!has_player) {
+            entity->_activity = ENTITY_ACTIVE;
+        } else {
+            vec3 d = vec3(entity->p) - player_pos;
+            float dist_sq = d.x * d.x + d.y * d.y + d.z * d.z;
+            
+            if (dist_sq < reduced_sq) {
+                entity->_activity = ENTITY_ACTIVE;
+            } else if (dist_sq < dormant_sq || !entity->_can_sleep()) {
+                entity->_activity = ENTITY_REDUCED;
+            } else {
+                entity->_activity = ENTITY_DORMANT;
+            }
+        }
+        
+        // Gravity is integrated for all bodies; don't let it pile up while
+        // the entity isn't moved
+        if (entity->_activity == ENTITY_DORMANT) {
+            entity->v = vec3();
+        }
+    }
+}
+
+bool activity_due(const entity_t* entity, uint32_t tick_index) {
+    switch (entity->_activity) {
+        case ENTITY_ACTIVE:
+            return true;
+        case ENTITY_REDUCED:
+            return (tick_index + entity->_body) % ACTIVITY_REDUCED_INTERVAL == 0;
+        default:
+            return false;
+    }
+}
+
+void activity_wake(entity_t* entity) {
+    entity->_activity = ENTITY_ACTIVE;
+    entity->_awake_until = entity->_ctx->time + ACTIVITY_WAKE_TIME;
+}
+
+void activity_noise(game_context_t* ctx, const vec3& pos, float radius) {
+    for (auto& entity : ctx->entities) {
+        if (entity->_activity_lod && !entity->_dead && vec3_dist(entity->p, pos) < radius) {
+            activity_wake(entity.get());
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef ACTIVITY_H
+#define ACTIVITY_H
+
+#include "../core/vec3.h"
+#include <cstdint>
+
+struct game_context_t;
+class entity_t;
+
+// How much of the update an entity gets, assigned each tick from its
+// distance to the player. Only entities that set _activity_lod take part;
+// everything else (player, projectiles, particles...) is always active.
+//
+//   ACTIVE   everything, every tick
+//   REDUCED  _think(), _update() and animation every ACTIVITY_REDUCED_INTERVAL
+//            ticks (staggered by body); physics still runs every tick so
+//            movement and collisions stay continuous
+//   DORMANT  frozen in place, only drawn; far entities only go to sleep when
+//            they can (_can_sleep()), entities _at_rest() sleep anywhere
+//
+// Damage, noise and triggers wake entities up and keep them active for a
+// while.
+enum entity_activity_t {
+    ENTITY_ACTIVE = 0,
+    ENTITY_REDUCED = 1,
+    ENTITY_DORMANT = 2
+};
+
+const float ACTIVITY_REDUCED_DIST = 1024;  // enemies attack from 800
+const float ACTIVITY_DORMANT_DIST = 2048;
+const uint32_t ACTIVITY_REDUCED_INTERVAL = 4;
+const float ACTIVITY_WAKE_TIME = 5;
+
+// Assign tiers for this tick; called before the update phases
+void activity_update(game_context_t* ctx);
+
+// Whether the entity's _think()/_update() run this tick
+bool activity_due(const entity_t* entity, uint32_t tick_index);
+
+// Keep an entity active for ACTIVITY_WAKE_TIME seconds
+void activity_wake(entity_t* entity);
+
+// Wake all entities within radius of pos (gun shots, explosions...)
+void activity_noise(game_context_t* ctx, const vec3& pos, float radius);
+
+#endif // ACTIVITY_H
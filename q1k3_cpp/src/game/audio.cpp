@@ -1,25 +1,18 @@
 #include "audio.h"
+#include "synth.h"
+#include "../core/spsc_ring.h"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 #include <iostream>
 #include <cmath>
 #include <cstring>
 #include <algorithm>
 
-// Constants
-static const int AUDIO_SAMPLERATE = 44100;
-static const int AUDIO_TAB_SIZE = 4096;
-static const int AUDIO_TAB_MASK = AUDIO_TAB_SIZE - 1;
-
-// Lookup tables for oscillators
-static float AUDIO_TAB[AUDIO_TAB_SIZE * 4];
-
-// SDL Audio device
-static SDL_AudioDeviceID audio_device = 0;
-static SDL_AudioSpec audio_spec;
-
 // Sound buffer storage
 static std::vector<std::unique_ptr<audio_buffer_t>> sound_buffers;
 
-// Sound effect pointers (indices into sound_buffers)
+// Sound effect handles: the audio_buffer_t, owned by sound_buffers
 void* sfx_shotgun_shoot = nullptr;
 void* sfx_shotgun_reload = nullptr;
 void* sfx_nailgun_shoot = nullptr;
@@ -35,205 +28,459 @@ void* sfx_enemy_gib = nullptr;
 void* sfx_zombie_hit = nullptr;
 void* sfx_hound_attack = nullptr;
 
-// Active sound instance
+// Sound effects: note and instrument, from the original's main.js. The
+// player's own shots are cut last when all voices are busy.
+struct audio_sound_t {
+    void** sfx;
+    int note;
+    int priority;
+    sound_def_t instrument;
+};
+
+static const audio_sound_t audio_sounds[] = {
+    {&sfx_enemy_hit, 135, 0, {8, 0, 0, 1, 148, 1, 3, 5, 0, 0, 139, 1, 0, 2653, 0, 2193, 255, 2, 639, 119, 2, 23, 0, 0, 0, 0, 0, 0, 0}},
+    {&sfx_enemy_gib, 140, 0, {7, 0, 0, 1, 148, 1, 7, 5, 0, 1, 139, 1, 0, 4611, 789, 15986, 195, 2, 849, 119, 3, 60, 0, 0, 0, 1, 10, 176, 1}},
+    {&sfx_hound_attack, 132, 0, {8, 0, 0, 1, 192, 1, 8, 0, 0, 1, 120, 1, 0, 5614, 0, 20400, 192, 1, 329, 252, 1, 55, 0, 0, 1, 1, 8, 192, 3}},
+    {&sfx_no_ammo, 120, 0, {8, 0, 0, 0, 96, 1, 8, 0, 0, 0, 0, 0, 255, 0, 0, 1075, 232, 1, 2132, 255, 0, 0, 0, 0, 0, 0, 0, 0, 0}},
+    {&sfx_hurt, 135, 0, {7, 3, 140, 1, 232, 3, 8, 0, 9, 1, 139, 3, 0, 4611, 1403, 34215, 256, 4, 1316, 255, 0, 0, 0, 1, 0, 1, 7, 255, 0}},
+    {&sfx_pickup, 140, 0, {7, 0, 0, 1, 187, 3, 8, 0, 0, 1, 204, 3, 0, 4298, 927, 1403, 255, 0, 0, 0, 3, 35, 0, 0, 0, 0, 0, 0, 0}},
+    {&sfx_plasma_shoot, 135, 0, {8, 0, 0, 1, 147, 1, 6, 0, 0, 1, 159, 1, 0, 197, 1234, 21759, 232, 2, 2902, 255, 2, 53, 0, 0, 0, 0, 0, 0, 0}},
+    {&sfx_shotgun_shoot, 135, 1, {7, 3, 0, 1, 255, 1, 6, 0, 0, 1, 255, 1, 112, 548, 1979, 11601, 255, 2, 2902, 176, 2, 77, 0, 0, 1, 0, 10, 255, 1}},
+    {&sfx_shotgun_reload, 125, 0, {9, 0, 0, 1, 131, 1, 0, 0, 0, 0, 0, 3, 255, 137, 22, 1776, 255, 2, 4498, 176, 2, 36, 2, 84, 0, 0, 3, 96, 0}},
+    {&sfx_nailgun_shoot, 130, 0, {7, 0, 0, 1, 132, 1, 8, 4, 0, 1, 132, 2, 162, 0, 0, 8339, 232, 2, 2844, 195, 2, 40, 0, 0, 0, 0, 0, 0, 0}},
+    {&sfx_grenade_shoot, 127, 0, {8, 0, 0, 1, 171, 1, 9, 3, 0, 1, 84, 3, 96, 2653, 0, 13163, 159, 2, 3206, 255, 2, 64, 0, 0, 0, 1, 9, 226, 0}},
+    {&sfx_grenade_explode, 135, 0, {8, 0, 0, 1, 195, 1, 6, 0, 0, 1, 127, 1, 255, 197, 1234, 21759, 232, 2, 1052, 255, 4, 73, 3, 25, 1, 0, 10, 227, 1}},
+};
+
+// The music, from the original's music_data
+static const synth_song_t audio_music = {
+    6014, 21, 88, {
+        {{7, 0, 0, 1, 255, 0, 7, 0, 0, 1, 255, 0, 0, 100, 0, 3636, 254, 2, 1199, 254, 4, 71, 0, 0, 0, 0, 0, 0, 0},
+         {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1},
+         {
+             {126, 126, 0, 0, 126, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 126, 126, 0, 0, 126, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}
+         }},
+        {{6, 0, 0, 0, 255, 2, 6, 0, 18, 0, 255, 2, 0, 100000, 56363, 100000, 199, 2, 200, 254, 8, 24, 0, 0, 0, 0, 0, 0, 0},
+         {0, 0, 2, 2, 3, 4, 2, 2, 3, 5, 2, 2, 3, 4, 2, 2, 3, 5},
+         {
+             {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+             {132, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+             {133, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 128, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+             {125, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+             {120, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}
+         }},
+        {{7, 0, 0, 0, 87, 2, 8, 0, 0, 0, 16, 3, 8, 0, 22, 2193, 255, 3, 1162, 51, 10, 182, 2, 190, 0, 1, 10, 96, 0},
+         {0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1},
+         {
+             {149, 149, 0, 0, 149, 0, 149, 0, 149, 149, 0, 0, 149, 0, 149, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}
+         }},
+        {{8, 0, 0, 0, 65, 2, 6, 0, 0, 0, 243, 3, 0, 200, 7505, 20000, 204, 4, 6180, 81, 4, 198, 0, 0, 0, 0, 6, 131, 0},
+         {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 3, 1, 1, 2, 3},
+         {
+             {132, 0, 0, 0, 0, 0, 0, 0, 133, 0, 0, 0, 137, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+             {132, 0, 0, 0, 0, 0, 0, 0, 133, 0, 0, 0, 130, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+             {132, 0, 0, 0, 0, 0, 0, 0, 133, 0, 0, 0, 125, 0, 0, 0, 0, 0, 0, 0, 125, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}
+         }}
+    }
+};
+
+// The music is synthesised while it plays, by audio_music_fill() on a
+// thread of its own that keeps AUDIO_MUSIC_AHEAD frames (about 0.7s, a few
+// rows) ready in a ring for audio_render()
+static const uint32_t AUDIO_MUSIC_AHEAD = 32768;
+static const int AUDIO_MUSIC_CHUNK = 1024;  // frames rendered at a time
+static synth_stream_t audio_music_stream;   // music thread
+static spsc_ring_t<float, AUDIO_MUSIC_AHEAD * 2> audio_music_ring;
+static std::atomic<bool> audio_music_playing{false};
+
+// Rendered sounds are kept here between runs
+static const char* AUDIO_CACHE_DIR = "cache/audio";
+
+// Active sound instance, only touched by the audio callback
 struct sound_instance_t {
     audio_buffer_t* buffer;
-    int position;
+    int position;       // frame
+    float position_frac;
+    float rate;         // frames per output frame
     float volume;
     float pan;
     bool active;
+    audio_voice_t voice;
 };
 
 // Maximum concurrent sounds
-static const int MAX_SOUNDS = 32;
+static const int MAX_SOUNDS = 128;
 static sound_instance_t active_sounds[MAX_SOUNDS];
-static SDL_mutex* audio_mutex = nullptr;
 
-// Audio callback for SDL
-static void audio_callback(void* userdata, Uint8* stream, int len) {
-    // Clear the stream
-    std::memset(stream, 0, len);
-    
-    // Convert to float buffer
-    float* out = reinterpret_cast<float*>(stream);
-    int samples = len / sizeof(float);
-    
-    SDL_LockMutex(audio_mutex);
-    
-    // Mix all active sounds
+// Commands from the game thread, applied at the start of each buffer
+enum audio_command_type_t {
+    AUDIO_COMMAND_PLAY,
+    AUDIO_COMMAND_STOP,
+    AUDIO_COMMAND_VOLUME,
+    AUDIO_COMMAND_PAN
+};
+
+struct audio_command_t {
+    audio_command_type_t type;
+    audio_voice_t voice;
+    audio_buffer_t* buffer;
+    float volume;
+    float pitch;
+    float pan;
+};
+
+static spsc_ring_t<audio_command_t, 256> audio_commands;
+static audio_voice_t audio_last_voice = 0;     // game thread
+
+static sound_instance_t* audio_find_voice(audio_voice_t voice) {
+    for (int i = 0; i < MAX_SOUNDS; i++) {
+        if (active_sounds[i].active && active_sounds[i].voice == voice) {
+            return &active_sounds[i];
+        }
+    }
+    return nullptr;
+}
+
+static void audio_gains(float volume, float pan, float* left, float* right) {
+    *left = volume * (1.0f - std::max(0.0f, pan));
+    *right = volume * (1.0f - std::max(0.0f, -pan));
+}
+
+static float audio_loudness(float volume, float pan) {
+    float left, right;
+    audio_gains(volume, pan, &left, &right);
+    return std::max(left, right);
+}
+
+// A free slot, or the one least worth keeping if that is less important
+// than the new sound: lower priority first, then the quietest
+static sound_instance_t* audio_find_slot(int priority, float loudness) {
+    sound_instance_t* victim = nullptr;
+    float victim_loudness = 0;
     for (int i = 0; i < MAX_SOUNDS; i++) {
         sound_instance_t& sound = active_sounds[i];
-        if (!sound.active || !sound.buffer) continue;
-        
-        // Calculate stereo pan
-        float left_vol = sound.volume * (1.0f - std::max(0.0f, sound.pan));
-        float right_vol = sound.volume * (1.0f - std::max(0.0f, -sound.pan));
-        
-        // Mix this sound
-        int samples_to_mix = std::min(samples / 2, sound.buffer->length - sound.position);
-        
-        for (int j = 0; j < samples_to_mix; j++) {
-            int src_idx = sound.position * 2;
-            int dst_idx = j * 2;
-            
-            // Mix left and right channels
-            out[dst_idx] += sound.buffer->data[src_idx] * left_vol;
-            out[dst_idx + 1] += sound.buffer->data[src_idx + 1] * right_vol;
-            
-            sound.position++;
+        if (!sound.active) {
+            return &sound;
         }
-        
-        // Deactivate sound if finished
-        if (sound.position >= sound.buffer->length) {
-            sound.active = false;
+        float l = audio_loudness(sound.volume, sound.pan);
+        if (!victim || sound.buffer->priority < victim->buffer->priority ||
+            (sound.buffer->priority == victim->buffer->priority && l < victim_loudness)) {
+            victim = &sound;
+            victim_loudness = l;
         }
     }
-    
-    SDL_UnlockMutex(audio_mutex);
-    
-    // Clamp output to prevent clipping
-    for (int i = 0; i < samples; i++) {
-        out[i] = std::max(-1.0f, std::min(1.0f, out[i]));
+    if (victim->buffer->priority > priority ||
+        (victim->buffer->priority == priority && victim_loudness > loudness)) {
+        return nullptr;
     }
+    return victim;
 }
 
-bool audio_init() {
-    // Initialize lookup tables
-    for (int i = 0; i < AUDIO_TAB_SIZE; i++) {
-        AUDIO_TAB[i] = std::sin(i * 6.283184f / AUDIO_TAB_SIZE); // sin
-        AUDIO_TAB[i + AUDIO_TAB_SIZE] = AUDIO_TAB[i] < 0 ? -1.0f : 1.0f; // square
-        AUDIO_TAB[i + AUDIO_TAB_SIZE * 2] = i / float(AUDIO_TAB_SIZE) - 0.5f; // saw
-        AUDIO_TAB[i + AUDIO_TAB_SIZE * 3] = i < AUDIO_TAB_SIZE/2 
-            ? (i / float(AUDIO_TAB_SIZE/4)) - 1.0f 
-            : 3.0f - (i / float(AUDIO_TAB_SIZE/4)); // tri
+static void audio_apply_commands(audio_render_stats_t* stats) {
+    audio_command_t command;
+    while (audio_commands.pop(command)) {
+        if (command.type == AUDIO_COMMAND_PLAY) {
+            sound_instance_t* sound = audio_find_slot(command.buffer->priority,
+                                                      audio_loudness(command.volume, command.pan));
+            if (!sound) {
+                stats->rejected++;
+            } else {
+                if (sound->active) {
+                    stats->stolen++;
+                }
+                sound->buffer = command.buffer;
+                sound->position = 0;
+                sound->position_frac = 0;
+                sound->rate = std::pow(2.0f, command.pitch / 12.0f);
+                sound->volume = command.volume;
+                sound->pan = command.pan;
+                sound->voice = command.voice;
+                sound->active = true;
+            }
+            continue;
+        }
+        
+        sound_instance_t* sound = audio_find_voice(command.voice);
+        if (!sound) {
+            continue;
+        }
+        switch (command.type) {
+            case AUDIO_COMMAND_STOP:
+                sound->active = false;
+                break;
+            case AUDIO_COMMAND_VOLUME:
+                sound->volume = command.volume;
+                break;
+            case AUDIO_COMMAND_PAN:
+                sound->pan = command.pan;
+                break;
+            default:
+                break;
+        }
     }
+}
+
+// A full queue drops the command; the game must never wait on the mixer
+static bool audio_push_command(audio_command_type_t type, audio_voice_t voice, audio_buffer_t* buffer,
+                               float volume, float pitch, float pan) {
+    return audio_commands.push({type, voice, buffer, volume, pitch, pan});
+}
+
+// Adds frames of a sound at its own rate to the interleaved stereo out, up
+// to its end. Returns the number of frames mixed.
+static int audio_mix_sound(sound_instance_t& sound, float* out, int frames) {
+    float left, right;
+    audio_gains(sound.volume, sound.pan, &left, &right);
+    const float* src = sound.buffer->data + sound.position * 2;
+    int remaining = sound.buffer->length - sound.position;
+    int j = 0;
     
-    // Create audio mutex
-    audio_mutex = SDL_CreateMutex();
-    if (!audio_mutex) {
-        std::cerr << "Failed to create audio mutex" << std::endl;
-        return false;
+    if (sound.rate == 1.0f && sound.position_frac == 0) {
+        // Straight copy: two frames per vector
+        int n = std::min(frames, remaining);
+#if defined(__SSE2__) || defined(_M_X64)
+        __m128 gain = _mm_setr_ps(left, right, left, right);
+        for (; j + 2 <= n; j += 2) {
+            __m128 s = _mm_loadu_ps(src + j * 2);
+            _mm_storeu_ps(out + j * 2, _mm_add_ps(_mm_loadu_ps(out + j * 2), _mm_mul_ps(s, gain)));
+        }
+#endif
+        for (; j < n; j++) {
+            out[j * 2] += src[j * 2] * left;
+            out[j * 2 + 1] += src[j * 2 + 1] * right;
+        }
+        sound.position += n;
+        if (sound.position >= sound.buffer->length) {
+            sound.active = false;
+        }
+        return n;
     }
     
-    // Initialize active sounds
-    for (int i = 0; i < MAX_SOUNDS; i++) {
-        active_sounds[i].active = false;
+    // Linear interpolation between the two frames around each position,
+    // as long as there is a frame after it. The estimate of n can be one
+    // too high after rounding, so it is checked against the positions the
+    // loops below compute (in float, the same way).
+    float frac = sound.position_frac;
+    float rate = sound.rate;
+    int n = remaining < 2 ? 0 :
+        static_cast<int>(std::min(static_cast<double>(frames),
+                                  std::ceil((remaining - 1 - static_cast<double>(frac)) / rate)));
+    while (n > 0 && frac + rate * static_cast<float>(n - 1) >= static_cast<float>(remaining - 1)) {
+        n--;
     }
-    
-    // Setup SDL audio
-    SDL_AudioSpec desired;
-    std::memset(&desired, 0, sizeof(desired));
-    desired.freq = AUDIO_SAMPLERATE;
-    desired.format = AUDIO_F32SYS;
-    desired.channels = 2;
-    desired.samples = 2048;
-    desired.callback = audio_callback;
-    
-    audio_device = SDL_OpenAudioDevice(nullptr, 0, &desired, &audio_spec, 0);
-    if (audio_device == 0) {
-        std::cerr << "Failed to open audio device: " << SDL_GetError() << std::endl;
-        return false;
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128 vleft = _mm_set1_ps(left);
+    const __m128 vright = _mm_set1_ps(right);
+    for (; j + 4 <= n; j += 4) {
+        float pos[4], l0[4], l1[4], r0[4], r1[4];
+        _mm_storeu_ps(pos, _mm_add_ps(_mm_set1_ps(frac),
+            _mm_mul_ps(_mm_set1_ps(rate), _mm_setr_ps(j, j + 1, j + 2, j + 3))));
+        int idx[4];
+        for (int k = 0; k < 4; k++) {
+            idx[k] = static_cast<int>(pos[k]);
+            const float* f = src + idx[k] * 2;
+            l0[k] = f[0];
+            r0[k] = f[1];
+            l1[k] = f[2];
+            r1[k] = f[3];
+        }
+        __m128 t = _mm_sub_ps(_mm_loadu_ps(pos), _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(idx))));
+        __m128 vl0 = _mm_loadu_ps(l0);
+        __m128 vr0 = _mm_loadu_ps(r0);
+        __m128 l = _mm_mul_ps(_mm_add_ps(vl0, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(l1), vl0), t)), vleft);
+        __m128 r = _mm_mul_ps(_mm_add_ps(vr0, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(r1), vr0), t)), vright);
+        float* o = out + j * 2;
+        _mm_storeu_ps(o, _mm_add_ps(_mm_loadu_ps(o), _mm_unpacklo_ps(l, r)));
+        _mm_storeu_ps(o + 4, _mm_add_ps(_mm_loadu_ps(o + 4), _mm_unpackhi_ps(l, r)));
+    }
+#endif
+    for (; j < n; j++) {
+        float pos = frac + rate * j;
+        int i = static_cast<int>(pos);
+        float t = pos - i;
+        const float* f = src + i * 2;
+        out[j * 2] += (f[0] + (f[2] - f[0]) * t) * left;
+        out[j * 2 + 1] += (f[1] + (f[3] - f[1]) * t) * right;
     }
     
-    // Start audio playback
-    SDL_PauseAudioDevice(audio_device, 0);
-    
-    // Generate all sound effects
-    audio_generate_sounds();
-    
-    return true;
+    double advance = frac + static_cast<double>(rate) * n;
+    int whole = static_cast<int>(advance);
+    sound.position += whole;
+    sound.position_frac = static_cast<float>(advance - whole);
+    if (n < frames || sound.position >= sound.buffer->length - 1) {
+        sound.active = false;
+    }
+    return n;
 }
 
-void audio_cleanup() {
-    if (audio_device != 0) {
-        SDL_CloseAudioDevice(audio_device);
-        audio_device = 0;
+// Unity gain below AUDIO_CLIP_KNEE, then bends smoothly towards +-1
+static const float AUDIO_CLIP_KNEE = 0.75f;
+
+static void audio_soft_clip(float* out, int samples) {
+    const float range = 1.0f - AUDIO_CLIP_KNEE;
+    int i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 knee = _mm_set1_ps(AUDIO_CLIP_KNEE);
+    const __m128 vrange = _mm_set1_ps(range);
+    const __m128 inv_range = _mm_set1_ps(1.0f / range);
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (; i + 4 <= samples; i += 4) {
+        __m128 x = _mm_loadu_ps(out + i);
+        __m128 sign = _mm_and_ps(x, sign_mask);
+        __m128 a = _mm_andnot_ps(sign_mask, x);
+        __m128 d = _mm_mul_ps(_mm_max_ps(_mm_sub_ps(a, knee), _mm_setzero_ps()), inv_range);
+        __m128 y = _mm_add_ps(_mm_min_ps(a, knee), _mm_mul_ps(vrange, _mm_div_ps(d, _mm_add_ps(one, d))));
+        _mm_storeu_ps(out + i, _mm_or_ps(y, sign));
     }
-    
-    if (audio_mutex) {
-        SDL_DestroyMutex(audio_mutex);
-        audio_mutex = nullptr;
+#endif
+    for (; i < samples; i++) {
+        float a = std::abs(out[i]);
+        float d = std::max(a - AUDIO_CLIP_KNEE, 0.0f) / range;
+        float y = std::min(a, AUDIO_CLIP_KNEE) + range * d / (1.0f + d);
+        out[i] = std::copysign(y, out[i]);
     }
-    
-    // Clean up sound buffers
-    for (auto& buffer : sound_buffers) {
-        if (buffer && buffer->data) {
-            delete[] buffer->data;
+}
+
+// Adds what the music thread has ready; if it falls behind, the music
+// drops out rather than the callback waiting
+static void audio_mix_music(float* out, int samples) {
+    if (!audio_music_playing.load(std::memory_order_relaxed)) {
+        return;
+    }
+    float chunk[AUDIO_MUSIC_CHUNK * 2];
+    while (samples > 0) {
+        uint32_t n = audio_music_ring.pop(chunk, std::min(samples, AUDIO_MUSIC_CHUNK * 2));
+        if (!n) {
+            return;
         }
+        for (uint32_t i = 0; i < n; i++) {
+            out[i] += chunk[i];
+        }
+        out += n;
+        samples -= n;
     }
-    sound_buffers.clear();
 }
 
-void audio_play(void* sound, float volume, float pitch, float pan) {
-    if (!sound) return;
+int audio_render(float* out, int frames, audio_render_stats_t* stats) {
+    int samples = frames * 2;
+    std::memset(out, 0, samples * sizeof(float));
     
-    // Convert sound pointer to buffer index
-    int buffer_idx = reinterpret_cast<intptr_t>(sound);
-    if (buffer_idx < 0 || buffer_idx >= sound_buffers.size()) return;
-    
-    audio_buffer_t* buffer = sound_buffers[buffer_idx].get();
-    if (!buffer) return;
-    
-    SDL_LockMutex(audio_mutex);
+    audio_render_stats_t local_stats;
+    if (!stats) {
+        stats = &local_stats;
+    }
+    *stats = {0, 0, 0};
+    audio_apply_commands(stats);
+    audio_mix_music(out, samples);
     
-    // Find a free sound slot
+    // Mix all active sounds
+    int& voices = stats->voices;
     for (int i = 0; i < MAX_SOUNDS; i++) {
-        if (!active_sounds[i].active) {
-            active_sounds[i].buffer = buffer;
-            active_sounds[i].position = 0;
-            active_sounds[i].volume = volume;
-            active_sounds[i].pan = pan;
-            active_sounds[i].active = true;
-            break;
+        sound_instance_t& sound = active_sounds[i];
+        if (!sound.active || !sound.buffer) {
+            continue;
+        }
+        voices++;
+        
+        // Looping sounds start over for the rest of the buffer
+        int mixed = 0;
+        while (sound.active && mixed < frames) {
+            int n = audio_mix_sound(sound, out + mixed * 2, frames - mixed);
+            mixed += n;
+            if (!sound.active && sound.buffer->loop && n > 0) {
+                sound.position = 0;
+                sound.position_frac = 0;
+                sound.active = true;
+            }
         }
     }
     
-    SDL_UnlockMutex(audio_mutex);
+    audio_soft_clip(out, samples);
+    return voices;
 }
 
-// Generate a single sound effect
-static audio_buffer_t* audio_generate_sound(const sound_def_t& def) {
-    // Simplified sound generation - would need full Sonant-X implementation
-    auto buffer = std::make_unique<audio_buffer_t>();
-    
-    // Calculate buffer size based on pattern length
-    int samples = AUDIO_SAMPLERATE; // 1 second for now
-    buffer->length = samples;
-    buffer->channels = 2;
-    buffer->data = new float[samples * 2];
-    
-    // Generate simple sine wave for now
-    for (int i = 0; i < samples; i++) {
-        float value = std::sin(i * 440.0f * 2.0f * M_PI / AUDIO_SAMPLERATE) * 0.3f;
-        buffer->data[i * 2] = value;     // Left
-        buffer->data[i * 2 + 1] = value; // Right
+int audio_music_fill() {
+    if (audio_music_ring.space() < AUDIO_MUSIC_CHUNK * 2) {
+        return 0;
     }
-    
-    return buffer.release();
+    float chunk[AUDIO_MUSIC_CHUNK * 2];
+    synth_stream_render(&audio_music_stream, chunk, AUDIO_MUSIC_CHUNK);
+    audio_music_ring.push(chunk, AUDIO_MUSIC_CHUNK * 2);
+    return AUDIO_MUSIC_CHUNK;
 }
 
-void audio_generate_sounds() {
-    // Sound definitions would go here
-    // For now, create dummy sounds
+audio_voice_t audio_play(void* sound, float volume, float pitch, float pan) {
+    audio_buffer_t* buffer = static_cast<audio_buffer_t*>(sound);
+    if (!buffer) return 0;
     
-    sound_def_t dummy_sound = {};
-    
-    // Generate all sound effects
-    sound_buffers.emplace_back(audio_generate_sound(dummy_sound));
-    sfx_shotgun_shoot = reinterpret_cast<void*>(0);
+    audio_voice_t voice = ++audio_last_voice;
+    if (!voice) {
+        voice = ++audio_last_voice;
+    }
+    if (!audio_push_command(AUDIO_COMMAND_PLAY, voice, buffer, volume, pitch, pan)) {
+        return 0;
+    }
+    return voice;
+}
+
+void audio_stop(audio_voice_t voice) {
+    if (voice) {
+        audio_push_command(AUDIO_COMMAND_STOP, voice, nullptr, 0, 0, 0);
+    }
+}
+
+void audio_set_volume(audio_voice_t voice, float volume) {
+    if (voice) {
+        audio_push_command(AUDIO_COMMAND_VOLUME, voice, nullptr, volume, 0, 0);
+    }
+}
+
+void audio_set_pan(audio_voice_t voice, float pan) {
+    if (voice) {
+        audio_push_command(AUDIO_COMMAND_PAN, voice, nullptr, 0, 0, pan);
+    }
+}
+
+void audio_generate_sounds(bool use_cache) {
+    // All sound effects in one go, on all job threads
+    const int num_sounds = sizeof(audio_sounds) / sizeof(audio_sounds[0]);
+    std::vector<synth_request_t> requests;
+    for (int i = 0; i < num_sounds; i++) {
+        requests.push_back({&audio_sounds[i].instrument, audio_sounds[i].note, nullptr, nullptr});
+    }
+    synth_render_all(requests.data(), static_cast<int>(requests.size()), use_cache ? AUDIO_CACHE_DIR : "");
     
-    sound_buffers.emplace_back(audio_generate_sound(dummy_sound));
-    sfx_shotgun_reload = reinterpret_cast<void*>(1);
+    for (int i = 0; i < num_sounds; i++) {
+        audio_buffer_t* buffer = requests[i].result;
+        buffer->priority = audio_sounds[i].priority;
+        sound_buffers.emplace_back(buffer);
+        *audio_sounds[i].sfx = buffer;
+    }
     
-    // ... and so on for all sound effects
+    std::cout << "Generated " << sound_buffers.size() << " sounds" << std::endl;
     
-    std::cout << "Generated " << sound_buffers.size() << " sound effects" << std::endl;
+    // Nothing plays from before, and the music starts from the top
+    for (int i = 0; i < MAX_SOUNDS; i++) {
+        active_sounds[i].active = false;
+    }
+    synth_stream_init(&audio_music_stream, &audio_music);
+    audio_music_playing = false;
+}
+
+void audio_free_sounds() {
+    for (auto& buffer : sound_buffers) {
+        if (buffer && buffer->data) {
+            delete[] buffer->data;
+        }
+    }
+    sound_buffers.clear();
 }
 
 void audio_play_music() {
-    // TODO: Implement music playback
+    audio_music_playing = true;
 }
 
 void audio_stop_music() {
-    // TODO: Stop music
+    audio_music_playing = false;
 }
\ No newline at end of file
@@ -1,41 +1,72 @@
 #ifndef AUDIO_H
 #define AUDIO_H
 
-#include <SDL2/SDL.h>
 #include <vector>
 #include <memory>
+#include <cstdint>
+
+const int AUDIO_SAMPLERATE = 44100;
 
 // Audio buffer structure
 struct audio_buffer_t {
     float* data;
     int length;
     int channels;
+    int priority;   // when all voices are busy, lower ones are cut first
+    bool loop;
 };
 
-// Sound definitions
+// Sonant-X instrument, rendered by synth.h
 struct sound_def_t {
-    // Instrument parameters
     int osc1_oct, osc1_det, osc1_detune, osc1_xenv, osc1_vol, osc1_waveform;
     int osc2_oct, osc2_det, osc2_detune, osc2_xenv, osc2_vol, osc2_waveform;
     int noise_fader, attack, sustain, release, master;
     int fx_filter, fx_freq, fx_resonance, fx_delay_time, fx_delay_amt, fx_pan_freq, fx_pan_amt;
     int lfo_osc1_freq, lfo_fx_freq, lfo_freq, lfo_amt, lfo_waveform;
-    
-    // Pattern data
-    std::vector<int> pattern;
 };
 
-// Initialize audio system
+// Open the output device and start the music thread
+// (platform/audio_device.cpp)
 bool audio_init();
 void audio_cleanup();
 
-// Play a sound
-void audio_play(void* sound, float volume = 1.0f, float pitch = 0.0f, float pan = 0.0f);
+// Playing sounds are named by the id audio_play() returns, 0 for none.
+// Ids of sounds that have finished are ignored.
+typedef uint32_t audio_voice_t;
+
+// Only to be called from the game thread. The commands are queued for the
+// audio callback, which never waits for the game. pitch is in semitones,
+// 0 plays the sound as it is.
+audio_voice_t audio_play(void* sound, float volume = 1.0f, float pitch = 0.0f, float pan = 0.0f);
+void audio_stop(audio_voice_t voice);
+void audio_set_volume(audio_voice_t voice, float volume);
+void audio_set_pan(audio_voice_t voice, float pan);
+
+// Render all sound effects and set the music up to start from the top
+// (audio_init() does this). Without the cache everything is rendered anew.
+void audio_generate_sounds(bool use_cache = true);
+void audio_free_sounds();
+
+// What one audio_render() did with the sounds
+struct audio_render_stats_t {
+    int voices;     // sounds mixed, the music not counted
+    int stolen;     // playing sounds cut off to make room for new ones
+    int rejected;   // new sounds not started, all playing ones mattered more
+};
+
+// The output side, for the device callback or an offline renderer: mixes
+// the next frames (interleaved stereo) of all playing sounds and the music
+// into out. Returns how many voices played, the music not counted; stats,
+// if given, gets the details.
+int audio_render(float* out, int frames, audio_render_stats_t* stats = nullptr);
 
-// Generate sound effects
-void audio_generate_sounds();
+// Synthesises the next chunk of music if there is room for it ahead of
+// audio_render(). Returns the frames rendered, 0 if there was no room.
+// Only one thread may call this.
+int audio_music_fill();
 
-// Play music
+// The music is one endless stream; stopping it pauses it and playing it
+// again carries on where it was
 void audio_play_music();
 void audio_stop_music();
 
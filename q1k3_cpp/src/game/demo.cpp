@@ -0,0 +1,298 @@
+#include "demo.h"
+#include "game.h"
+#include "entity.h"
+#include "../platform/input.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cstring>
+
+static const uint8_t DEMO_VERSION = 1;
+
+static void demo_write_u16(std::vector<uint8_t>& out, uint16_t v) {
+    out.push_back(v & 0xff);
+    out.push_back(v >> 8);
+}
+
+static void demo_write_u32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back((v >> (i * 8)) & 0xff);
+    }
+}
+
+static void demo_write_f32(std::vector<uint8_t>& out, float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, 4);
+    demo_write_u32(out, bits);
+}
+
+static uint16_t demo_read_u16(const uint8_t* d) {
+    return d[0] | (d[1] << 8);
+}
+
+static uint32_t demo_read_u32(const uint8_t* d) {
+    return d[0] | (d[1] << 8) | (d[2] << 16) | (static_cast<uint32_t>(d[3]) << 24);
+}
+
+static float demo_read_f32(const uint8_t* d) {
+    uint32_t bits = demo_read_u32(d);
+    float v;
+    std::memcpy(&v, &bits, 4);
+    return v;
+}
+
+// Put the game into the exact same state for recording and playback
+static void demo_reset_game(game_context_t* ctx, int map_index, uint32_t seed) {
+    demo_t& demo = ctx->demo;
+    demo.map_index = map_index;
+    demo.seed = seed;
+    demo.tick = 0;
+    demo.diverged_at = -1;
+    demo.verified = 0;
+    demo.next_checksum = 0;
+    demo.sim_seconds = 0;
+    game_reset(ctx, map_index, seed);
+}
+
+bool demo_record_start(game_context_t* ctx, const std::string& path, int map_index, uint32_t seed) {
+    demo_stop(ctx);
+
+    demo_t& demo = ctx->demo;
+    demo.path = path;
+    demo.inputs.clear();
+    demo.checksums.clear();
+    demo.checksum_interval = DEMO_CHECKSUM_INTERVAL;
+    demo_reset_game(ctx, map_index, seed);
+    demo.mode = DEMO_RECORD;
+
+    std::cout << "Recording demo: " << path << std::endl;
+    return true;
+}
+
+bool demo_play_start(game_context_t* ctx, const std::string& path) {
+    demo_stop(ctx);
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open demo: " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+
+    // Header
+    if (data.size() < 12 || std::memcmp(data.data(), "Q1KD", 4) != 0 ||
+        data[4] != DEMO_VERSION) {
+        std::cerr << "Not a valid demo file: " << path << std::endl;
+        return false;
+    }
+    int map_index = data[5];
+    uint32_t seed = demo_read_u32(&data[6]);
+    int checksum_interval = demo_read_u16(&data[10]);
+    if (checksum_interval == 0) {
+        std::cerr << "Invalid checksum interval in demo: " << path << std::endl;
+        return false;
+    }
+
+    // Chunks
+    demo_t& demo = ctx->demo;
+    demo.inputs.clear();
+    demo.checksums.clear();
+    size_t i = 12;
+    while (i < data.size()) {
+        uint8_t tag = data[i++];
+        if (tag == 'I' && i + 11 <= data.size()) {
+            input_state_t state;
+            int count = data[i];
+            state.keys = demo_read_u16(&data[i + 1]);
+            state.mouse_x = demo_read_f32(&data[i + 3]);
+            state.mouse_y = demo_read_f32(&data[i + 7]);
+            demo.inputs.insert(demo.inputs.end(), count, state);
+            i += 11;
+        } else if (tag == 'C' && i + 8 <= data.size()) {
+            // Checksums are of ticks whose input came before, in order and
+            // at the interval given in the header
+            uint32_t tick = demo_read_u32(&data[i]);
+            if (tick >= demo.inputs.size() || tick % checksum_interval != 0 ||
+                (!demo.checksums.empty() && tick <= demo.checksums.back().first)) {
+                std::cerr << "Bad checksum tick " << tick << " at " << (i - 1) << ": " << path << std::endl;
+                return false;
+            }
+            demo.checksums.push_back({tick, demo_read_u32(&data[i + 4])});
+            i += 8;
+        } else {
+            std::cerr << "Corrupt demo chunk at " << (i - 1) << ": " << path << std::endl;
+            return false;
+        }
+    }
+
+    demo.path = path;
+    demo.checksum_interval = checksum_interval;
+    demo_reset_game(ctx, map_index, seed);
+    demo.mode = DEMO_PLAY;
+
+    std::cout << "Playing demo: " << path << " (" << demo.inputs.size() << " ticks)" << std::endl;
+    return true;
+}
+
+static void demo_write(const demo_t& demo) {
+    std::vector<uint8_t> out;
+    out.insert(out.end(), {'Q', '1', 'K', 'D'});
+    out.push_back(DEMO_VERSION);
+    out.push_back(static_cast<uint8_t>(demo.map_index));
+    demo_write_u32(out, demo.seed);
+    demo_write_u16(out, DEMO_CHECKSUM_INTERVAL);
+
+    // Input is run length encoded; checksums go right after the input of
+    // the tick they belong to
+    const std::vector<input_state_t>& inputs = demo.inputs;
+    const std::vector<std::pair<uint32_t, uint32_t>>& checksums = demo.checksums;
+    size_t c = 0;
+    size_t i = 0;
+    while (i < inputs.size()) {
+        size_t run = 1;
+        while (i + run < inputs.size() && run < 255 &&
+               inputs[i + run] == inputs[i] &&
+               (c >= checksums.size() || i + run <= checksums[c].first)) {
+            run++;
+        }
+
+        out.push_back('I');
+        out.push_back(static_cast<uint8_t>(run));
+        demo_write_u16(out, inputs[i].keys);
+        demo_write_f32(out, inputs[i].mouse_x);
+        demo_write_f32(out, inputs[i].mouse_y);
+        i += run;
+
+        while (c < checksums.size() && checksums[c].first < i) {
+            out.push_back('C');
+            demo_write_u32(out, checksums[c].first);
+            demo_write_u32(out, checksums[c].second);
+            c++;
+        }
+    }
+
+    std::ofstream file(demo.path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to write demo: " << demo.path << std::endl;
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(out.data()), out.size());
+    std::cout << "Recorded demo: " << demo.path << " (" << inputs.size()
+              << " ticks, " << out.size() << " bytes)" << std::endl;
+}
+
+void demo_stop(game_context_t* ctx) {
+    demo_t& demo = ctx->demo;
+    if (demo.mode == DEMO_RECORD) {
+        demo_write(demo);
+    } else if (demo.mode == DEMO_PLAY) {
+        // One write, worlds played on other threads may finish at the same time
+        std::ostringstream summary;
+        summary << "Demo finished: " << demo.tick << " ticks, "
+                << (demo.tick ? demo.sim_seconds * 1000.0 / demo.tick : 0) << " ms/tick";
+        if (demo.diverged_at >= 0) {
+            summary << ", DIVERGED at tick " << demo.diverged_at;
+        } else if (demo.verified == 0) {
+            summary << ", unverified (no checksums)";
+        } else {
+            summary << ", in sync (" << demo.verified << " checksums)";
+        }
+        summary << "\n";
+        std::cout << summary.str() << std::flush;
+    }
+    demo.mode = DEMO_NONE;
+}
+
+bool demo_recording(const game_context_t* ctx) {
+    return ctx->demo.mode == DEMO_RECORD;
+}
+
+bool demo_playing(const game_context_t* ctx) {
+    return ctx->demo.mode == DEMO_PLAY;
+}
+
+bool demo_diverged(const game_context_t* ctx) {
+    return ctx->demo.diverged_at >= 0;
+}
+
+void demo_tick_begin(game_context_t* ctx) {
+    demo_t& demo = ctx->demo;
+    if (demo.mode == DEMO_RECORD) {
+        demo.inputs.push_back(ctx->input->get_state());
+    } else if (demo.mode == DEMO_PLAY) {
+        if (demo.tick >= demo.inputs.size()) {
+            demo_stop(ctx);
+            return;
+        }
+        ctx->input->set_state(demo.inputs[demo.tick]);
+        demo.tick_start = std::chrono::steady_clock::now();
+    }
+}
+
+void demo_tick_end(game_context_t* ctx) {
+    demo_t& demo = ctx->demo;
+    if (demo.mode == DEMO_NONE) {
+        return;
+    }
+
+    if (demo.mode == DEMO_PLAY) {
+        demo.sim_seconds += std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - demo.tick_start).count();
+    }
+
+    if (demo.tick % demo.checksum_interval == 0) {
+        uint32_t checksum = demo_checksum(ctx);
+        if (demo.mode == DEMO_RECORD) {
+            demo.checksums.push_back({demo.tick, checksum});
+        } else if (demo.next_checksum < demo.checksums.size() &&
+                   demo.checksums[demo.next_checksum].first == demo.tick) {
+            // Checksums are in tick order (checked on load)
+            demo.verified++;
+            if (demo.checksums[demo.next_checksum].second != checksum && demo.diverged_at < 0) {
+                demo.diverged_at = demo.tick;
+                std::cerr << "Demo diverged at tick " << demo.tick << " (checksum " << std::hex
+                          << checksum << ", recorded " << demo.checksums[demo.next_checksum].second
+                          << std::dec << ")" << std::endl;
+            }
+            demo.next_checksum++;
+        }
+    }
+
+    demo.tick++;
+    if (demo.mode == DEMO_PLAY && demo.tick >= demo.inputs.size()) {
+        demo_stop(ctx);
+    }
+}
+
+// FNV-1a over the state of all entities, in entity order, and projectiles
+uint32_t demo_checksum(game_context_t* ctx) {
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+    };
+
+    uint32_t count = static_cast<uint32_t>(ctx->entities.size());
+    mix(&count, sizeof(count));
+    for (auto& entity : ctx->entities) {
+        float state[8] = {
+            entity->p.x, entity->p.y, entity->p.z,
+            entity->v.x, entity->v.y, entity->v.z,
+            entity->_health, entity->_yaw
+        };
+        mix(state, sizeof(state));
+        mix(&entity->_dead, sizeof(entity->_dead));
+    }
+    for (const auto& pool : ctx->projectiles.pools) {
+        for (const auto& pr : pool) {
+            float state[6] = {pr.p.x, pr.p.y, pr.p.z, pr.v.x, pr.v.y, pr.v.z};
+            mix(state, sizeof(state));
+        }
+    }
+    mix(&ctx->time, sizeof(ctx->time));
+    return hash;
+}
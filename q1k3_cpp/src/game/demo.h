@@ -0,0 +1,75 @@
+#ifndef DEMO_H
+#define DEMO_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include "../platform/input.h"
+
+struct game_context_t;
+
+// Demo recording and playback. A demo stores the map index, the random seed
+// and the input state of every simulation tick; playing it back feeds that
+// input to the player instead of the live one. A checksum of all entity
+// state is stored every DEMO_CHECKSUM_INTERVAL ticks to detect divergence.
+//
+// File format (little endian):
+//   "Q1KD", u8 version, u8 map_index, u32 seed, u16 checksum_interval
+//   then chunks of
+//   'I' u8 count, u16 keys, f32 mouse_x, f32 mouse_y  - input for count ticks
+//   'C' u32 tick, u32 checksum                        - state after tick
+//   Checksum ticks are multiples of checksum_interval, in increasing order.
+//   Playback reports how many of them it verified.
+
+const int DEMO_CHECKSUM_INTERVAL = 60;
+
+enum demo_mode_t {
+    DEMO_NONE,
+    DEMO_RECORD,
+    DEMO_PLAY
+};
+
+// Recording or playback of one world, owned by its game_context_t
+struct demo_t {
+    demo_mode_t mode = DEMO_NONE;
+    std::string path;
+    int map_index = 0;
+    uint32_t seed = 0;
+    uint32_t tick = 0;
+    int diverged_at = -1;
+    int checksum_interval = DEMO_CHECKSUM_INTERVAL;
+    int verified = 0;           // checksums compared during playback
+    
+    // Input of every tick and (tick, checksum) pairs
+    std::vector<input_state_t> inputs;
+    std::vector<std::pair<uint32_t, uint32_t>> checksums;
+    size_t next_checksum = 0;
+    
+    // Time spent simulating during playback
+    std::chrono::steady_clock::time_point tick_start;
+    double sim_seconds = 0;
+};
+
+// Reset ctx to map_index with the given seed and start recording it
+bool demo_record_start(game_context_t* ctx, const std::string& path, int map_index, uint32_t seed);
+
+// Load a demo, reset ctx to its map & seed and start playing it back
+bool demo_play_start(game_context_t* ctx, const std::string& path);
+
+// Finish recording (writes the file) or playback (prints a summary) of ctx
+void demo_stop(game_context_t* ctx);
+
+bool demo_recording(const game_context_t* ctx);
+bool demo_playing(const game_context_t* ctx);
+bool demo_diverged(const game_context_t* ctx);
+
+// Wrap each game_update(); only do something if ctx is being recorded or
+// played back
+void demo_tick_begin(game_context_t* ctx);
+void demo_tick_end(game_context_t* ctx);
+
+// Hash of the state of all entities in ctx
+uint32_t demo_checksum(game_context_t* ctx);
+
+#endif // DEMO_H
@@ -1,56 +1,84 @@
 #include "entity.h"
 #include "entity_particle.h"  // For entity_particle_t
+#include "physics.h"
 #include "../renderer/renderer.h"  // For model_t definition
 #include <cmath>
 #include <algorithm>
 
-entity_t::entity_t(const vec3& pos, void* p1, void* p2) 
-    : a(), v(), p(pos), s(2, 2, 2), f(0),
+// Per-entity random streams, handed out in spawn order. Stream 0 is the
+// context's own.
+static random_t entity_next_random(game_context_t* ctx) {
+    random_t r;
+    random_seed(&r, ctx->seed_base, ++ctx->seed_counter);
+    return r;
+}
+
+entity_t::entity_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2) 
+    : _ctx(ctx), _body(physics_body_alloc(*ctx->physics, pos)),
+      a(physics_body_a(*ctx->physics, _body)), v(physics_body_v(*ctx->physics, _body)),
+      p(physics_body_p(*ctx->physics, _body)),
+      s(2, 2, 2), f(ctx->physics->f[_body]),
       _health(50), _dead(false), _die_at(0), _step_height(0),
-      _bounciness(0), _gravity(1), _yaw(0), _pitch(0),
-      _anim({1, {0}}), _anim_time(static_cast<float>(rand()) / RAND_MAX),
+      _bounciness(ctx->physics->bounciness[_body]), _gravity(ctx->physics->gravity[_body]),
+      _yaw(0), _pitch(0),
+      _anim({1, {0}}), _anim_time(random_float(&ctx->random)),
       _on_ground(false), _keep_off_ledges(false),
       _check_against(ENTITY_GROUP_NONE), _stepped_up_at(0),
-      _model(nullptr), _texture(0) {
+      _model(nullptr), _texture(0), _check_entities(nullptr),
+      _random_state(entity_next_random(ctx)),
+      _activity_lod(false), _activity(ENTITY_ACTIVE), _awake_until(0),
+      _trigger(-1) {
     
     _init(p1, p2);
 }
 
+entity_t::~entity_t() {
+    physics_body_free(*_ctx->physics, _body);
+}
+
 void entity_t::_update() {
+}
+
+void entity_t::_draw(float alpha) {
     if (_model) {
-        _draw_model();
+        _draw_model(alpha);
     }
 }
 
+// Position interpolated between the start and the end of the last tick
+vec3 entity_t::_draw_pos(float alpha) {
+    vec3 prev = physics_body_prev_p(*_ctx->physics, _body);
+    return prev + (vec3(p) - prev) * alpha;
+}
+
+// Runs in parallel for all entities. Only this entity's body is moved; other
+// entities are tested at their position from the start of the tick and all
+// collision callbacks are deferred to _apply_contacts().
 void entity_t::_update_physics() {
-    if (_die_at && _die_at < game_time) {
-        _kill();
+    _contacts.clear();
+    if (_dead) {
         return;
     }
 
-    // Apply Gravity
-    a.y = -1200 * _gravity;
-
-    // Integrate acceleration & friction into velocity
-    float ff = std::min(f * game_tick, 1.0f);
-    v = v + (a * game_tick - v * vec3(ff, 0, ff));
+    // Gravity, acceleration & friction have already been integrated into
+    // velocity for all bodies by physics_integrate(); resolve movement here.
 
     // Set up the _check_entities array for entity collisions
     switch (_check_against) {
         case ENTITY_GROUP_NONE:
-            _check_entities.clear();
+            _check_entities = nullptr;
             break;
         case ENTITY_GROUP_PLAYER:
-            _check_entities = game_entities_friendly;
+            _check_entities = &_ctx->entities_friendly;
             break;
         case ENTITY_GROUP_ENEMY:
-            _check_entities = game_entities_enemies;
+            _check_entities = &_ctx->entities_enemies;
             break;
     }
 
     // Divide the physics integration into 16 unit steps
     float original_step_height = _step_height;
-    vec3 move_dist = v * game_tick;
+    vec3 move_dist = v * _ctx->tick;
     int steps = std::ceil(vec3_length(move_dist) / 16.0f);
     vec3 move_step = move_dist * (1.0f / steps);
 
@@ -62,12 +90,12 @@ void entity_t::_update_physics() {
         if (_collides(vec3(p.x, lp.y, lp.z))) {
             if (!_step_height || !_on_ground || v.y > 0 || 
                 _collides(vec3(p.x, lp.y + _step_height, lp.z))) {
-                _did_collide(0);
+                _contacts.push_back({0, nullptr, v});
                 p.x = lp.x;
                 v.x = -v.x * _bounciness;
             } else {
                 lp.y += _step_height;
-                _stepped_up_at = game_time;
+                _stepped_up_at = _ctx->time;
             }
             s = steps;
         }
@@ -76,19 +104,19 @@ void entity_t::_update_physics() {
         if (_collides(vec3(p.x, lp.y, p.z))) {
             if (!_step_height || !_on_ground || v.y > 0 || 
                 _collides(vec3(p.x, lp.y + _step_height, p.z))) {
-                _did_collide(2);
+                _contacts.push_back({2, nullptr, v});
                 p.z = lp.z;
                 v.z = -v.z * _bounciness;
             } else {
                 lp.y += _step_height;
-                _stepped_up_at = game_time;
+                _stepped_up_at = _ctx->time;
             }
             s = steps;
         }
 
         // Collision with ground/ceiling
         if (_collides(p)) {
-            _did_collide(1);
+            _contacts.push_back({1, nullptr, v});
             p.y = lp.y;
 
             float bounce = std::abs(v.y) > 200 ? _bounciness : 0;
@@ -106,27 +134,43 @@ bool entity_t::_collides(const vec3& p) {
         return false;
     }
 
-    for (auto& entity : _check_entities) {
-        if (vec3_dist(p, entity->p) < s.y + entity->s.y) {
-            _step_height = 0;
-            _did_collide_with_entity(entity);
-            return true;
+    if (_check_entities) {
+        for (auto& entity : *_check_entities) {
+            if (vec3_dist(p, physics_body_prev_p(*_ctx->physics, entity->_body)) < s.y + entity->s.y) {
+                _step_height = 0;
+                _contacts.push_back({-1, entity.get(), v});
+                return true;
+            }
         }
     }
 
     // Check if there's no block beneath this point
     if (_on_ground && _keep_off_ledges &&
-        !map_block_at(p.x / 32, (p.y - s.y - 8) / 16, p.z / 32) &&
-        !map_block_at(p.x / 32, (p.y - s.y - 24) / 16, p.z / 32)) {
+        !map_solid_at(_ctx, p.x / 32, (p.y - s.y - 8) / 16, p.z / 32) &&
+        !map_solid_at(_ctx, p.x / 32, (p.y - s.y - 24) / 16, p.z / 32)) {
         return true;
     }
 
-    return map_block_at_box(p - s, p + s);
+    return map_solid_at_box(_ctx, p - s, p + s);
 }
 
-void entity_t::_draw_model() {
-    _anim_time += game_tick;
+void entity_t::_apply_contacts() {
+    for (const auto& contact : _contacts) {
+        // A collision may have killed us; later ones would have been missed
+        if (_dead) {
+            break;
+        }
+        _contact_v = contact.v;
+        if (contact.axis < 0) {
+            _did_collide_with_entity(contact.other->shared_from_this());
+        } else {
+            _did_collide(contact.axis);
+        }
+    }
+    _contacts.clear();
+}
 
+void entity_t::_draw_model(float alpha) {
     float f = _anim_time / _anim.first;
     float mix = f - static_cast<int>(f);
     int frame_cur = _anim.second[static_cast<int>(f) % _anim.second.size()];
@@ -137,21 +181,28 @@ void entity_t::_draw_model() {
         mix = 1 - mix;
     }
 
-    r_draw(p, _yaw, _pitch, _texture,
-           _model->f[frame_cur], _model->f[frame_next], mix,
-           _model->nv);
+    r_draw_model(_draw_pos(alpha), _yaw, _pitch, _texture,
+                 _model, frame_cur, frame_next, mix);
 }
 
 void entity_t::_spawn_particles(int amount, float speed, model_t* model, int texture, float lifetime) {
+    game_spawn_particles(_ctx, p, amount, speed, model, texture, lifetime);
+}
+
+void game_spawn_particles(game_context_t* ctx, const vec3& pos, int amount, float speed,
+                          model_t* model, int texture, float lifetime) {
     for (int i = 0; i < amount; i++) {
-        auto particle = game_spawn<entity_particle_t>(p);
+        auto particle = game_spawn<entity_particle_t>(ctx, pos);
+        if (!particle) {
+            return;
+        }
         particle->_model = model;
         particle->_texture = texture;
-        particle->_die_at = game_time + lifetime + static_cast<float>(rand()) / RAND_MAX * lifetime * 0.2f;
+        particle->_die_at = ctx->time + lifetime + random_float(&ctx->random) * lifetime * 0.2f;
         particle->v = vec3(
-            (static_cast<float>(rand()) / RAND_MAX - 0.5f) * speed,
-            static_cast<float>(rand()) / RAND_MAX * speed,
-            (static_cast<float>(rand()) / RAND_MAX - 0.5f) * speed
+            (random_float(&ctx->random) - 0.5f) * speed,
+            random_float(&ctx->random) * speed,
+            (random_float(&ctx->random) - 0.5f) * speed
         );
     }
 }
@@ -160,6 +211,7 @@ void entity_t::_receive_damage(EntityPtr from, float amount) {
     if (_dead) {
         return;
     }
+    activity_wake(this);
     _health -= amount;
     if (_health <= 0) {
         _kill();
@@ -167,11 +219,19 @@ void entity_t::_receive_damage(EntityPtr from, float amount) {
 }
 
 void entity_t::_play_sound(void* sound) {
-    float volume = clamp(scale(vec3_dist(p, r_camera), 64, 1200, 1, 0), 0, 1);
-    float pan = std::sin(vec3_2d_angle(p, r_camera) - r_camera_yaw) * -1;
+    float volume = clamp(scale(vec3_dist(p, _ctx->camera), 64, 1200, 1, 0), 0, 1);
+    float pan = std::sin(vec3_2d_angle(p, _ctx->camera) - _ctx->camera_yaw) * -1;
     audio_play(sound, volume, 0, pan);
 }
 
+float entity_t::_random() {
+    return random_float(&_random_state);
+}
+
 void entity_t::_kill() {
+    if (_trigger >= 0) {
+        trigger_remove(_ctx, _trigger);
+        _trigger = -1;
+    }
     _dead = true;
 }
\ No newline at end of file
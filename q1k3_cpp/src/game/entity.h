@@ -3,8 +3,12 @@
 
 #include <vector>
 #include <memory>
+#include <cstdint>
 #include "../core/vec3.h"
 #include "../core/math_utils.h"
+#include "game.h"
+#include "activity.h"
+#include "physics.h"
 
 enum EntityGroup {
     ENTITY_GROUP_NONE = 0,
@@ -15,39 +19,40 @@ enum EntityGroup {
 class entity_t;
 using EntityPtr = std::shared_ptr<entity_t>;
 
+// Collision recorded during the (parallel) physics phase, applied later in
+// entity order on the main thread. axis < 0 means a collision with other.
+struct entity_contact_t {
+    int axis;
+    entity_t* other;
+    vec3 v; // velocity at the time of the collision
+};
+
 // Forward declarations
 struct model_t;
 class entity_particle_t;
 class entity_light_t;
-void r_draw(const vec3& pos, float yaw, float pitch, int texture, 
-            int frame1, int frame2, float mix, int num_verts);
-extern vec3 r_camera;
-extern float r_camera_yaw;
-void audio_play(void* sound, float volume = 1.0f, float pitch = 0.0f, float pan = 0.0f);
-bool map_block_at(int x, int y, int z);
-bool map_block_at_box(const vec3& min, const vec3& max);
-
-// Global entity lists (defined in game.cpp)
-extern std::vector<EntityPtr> game_entities;
-extern std::vector<EntityPtr> game_entities_friendly;
-extern std::vector<EntityPtr> game_entities_enemies;
-extern float game_time;
-extern float game_tick;
+void r_draw_model(const vec3& pos, float yaw, float pitch, int texture,
+                  const model_t* model, int frame1, int frame2, float mix);
+typedef uint32_t audio_voice_t;
+audio_voice_t audio_play(void* sound, float volume = 1.0f, float pitch = 0.0f, float pan = 0.0f);
 
 class entity_t : public std::enable_shared_from_this<entity_t> {
 public:
-    vec3 a;  // acceleration
-    vec3 v;  // velocity  
-    vec3 p;  // position
-    vec3 s;  // size
-    float f; // friction
+    game_context_t* _ctx; // the world this entity lives in; declared first
+    int _body;            // handle into _ctx->physics
+    
+    vec3_ref a;  // acceleration
+    vec3_ref v;  // velocity  
+    vec3_ref p;  // position
+    vec3 s;      // size
+    float& f;    // friction
 
     float _health;
     bool _dead;
     float _die_at;
     float _step_height;
-    float _bounciness;
-    float _gravity;
+    float& _bounciness;
+    float& _gravity;
     float _yaw;
     float _pitch;
     std::pair<float, std::vector<int>> _anim;
@@ -63,32 +68,71 @@ public:
     int _texture;
     
     // Entities to check collisions against
-    std::vector<EntityPtr> _check_entities;
+    const std::vector<EntityPtr>* _check_entities;
+    
+    // Collisions from the last _update_physics() and the velocity at the
+    // time of the one currently being applied
+    std::vector<entity_contact_t> _contacts;
+    vec3 _contact_v;
+    
+    // Per-entity random stream, so _think() is deterministic on any thread
+    random_t _random_state;
+    
+    // Distance based update tiers, see activity.h
+    bool _activity_lod;
+    entity_activity_t _activity;
+    float _awake_until;
+    
+    int _trigger;   // handle into _ctx->triggers or -1
 
-    entity_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
-    virtual ~entity_t() = default;
+    entity_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    virtual ~entity_t();
     
     virtual void _init(void* /*p1*/, void* /*p2*/) {}
+    
+    // Called in parallel for all entities; may only modify this entity
+    virtual void _think() {}
+    
     virtual void _update();
     virtual void _update_physics();
+    
+    // Called once per rendered frame. alpha is how far the renderer is
+    // between the previous and the current simulation tick.
+    virtual void _draw(float alpha);
+    vec3 _draw_pos(float alpha);
+    void _apply_contacts();
     virtual void _did_collide(int /*axis*/) {}
     virtual void _did_collide_with_entity(EntityPtr /*other*/) {}
     
-    void _draw_model();
+    void _draw_model(float alpha);
     bool _collides(const vec3& p);
     void _spawn_particles(int amount, float speed, model_t* model, int texture, float lifetime);
     virtual void _receive_damage(EntityPtr from, float amount);
     void _play_sound(void* sound);
+    float _random();
+    virtual bool _can_sleep() { return _on_ground || _at_rest(); }
+    virtual bool _at_rest() { return false; }    // sleep until disturbed, even near the player
+    virtual void _trigger_enter(entity_t* /*other*/) {}
+    virtual void _trigger_exit(entity_t* /*other*/) {}
+    virtual bool _needs_los() { return false; }  // will _think() look for the player?
     virtual void _kill();
 };
 
-// Template spawn function (implementation here to avoid linker issues)
+// Template spawn function (implementation here to avoid linker issues).
+// Returns null if the world is out of physics bodies.
 template<typename T>
-std::shared_ptr<T> game_spawn(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr) {
-    auto entity = std::make_shared<T>(pos, p1, p2);
+std::shared_ptr<T> game_spawn(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr) {
+    if (!physics_body_available(*ctx->physics)) {
+        return nullptr;
+    }
+    auto entity = std::make_shared<T>(ctx, pos, p1, p2);
     entity->_init(p1, p2);  // Call _init after construction
-    game_entities.push_back(entity);
+    ctx->entities.push_back(entity);
     return entity;
 }
 
+// Particles flying off from pos, for effects without an entity to emit them
+void game_spawn_particles(game_context_t* ctx, const vec3& pos, int amount, float speed,
+                          model_t* model, int texture, float lifetime);
+
 #endif // ENTITY_H
\ No newline at end of file
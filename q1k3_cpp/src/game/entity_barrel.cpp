@@ -10,8 +10,8 @@ static model_t* model_barrel = nullptr;
 static model_t* model_gib_pieces[4] = {nullptr, nullptr, nullptr, nullptr};
 static void* sfx_grenade_explode = nullptr;
 
-entity_barrel_t::entity_barrel_t(const vec3& pos, void* p1, void* p2) 
-    : entity_t(pos, p1, p2) {
+entity_barrel_t::entity_barrel_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2) 
+    : entity_t(ctx, pos, p1, p2) {
 }
 
 void entity_barrel_t::_init(void* /*p1*/, void* /*p2*/) {
@@ -20,12 +20,14 @@ void entity_barrel_t::_init(void* /*p1*/, void* /*p2*/) {
     _pitch = M_PI/2;
     _health = 10;
     s = vec3(8, 32, 8);
+    _activity_lod = true;
     
-    game_entities_enemies.push_back(shared_from_this());
+    _ctx->entities_enemies.push_back(shared_from_this());
 }
 
-void entity_barrel_t::_update() {
-    _draw_model();
+// Barrels sleep once they stand; damage wakes them
+bool entity_barrel_t::_at_rest() {
+    return _on_ground;
 }
 
 void entity_barrel_t::_kill() {
@@ -35,7 +37,7 @@ void entity_barrel_t::_kill() {
 
 void entity_barrel_t::_explode() {
     // Deal damage to nearby entities
-    for (auto& entity : game_entities_enemies) {
+    for (auto& entity : _ctx->entities_enemies) {
         float dist = vec3_dist(p, entity->p);
         if (entity.get() != this && dist < 256) {
             entity->_receive_damage(shared_from_this(), scale(dist, 0, 256, 60, 0));
@@ -43,6 +45,7 @@ void entity_barrel_t::_explode() {
     }
     
     _play_sound(sfx_grenade_explode);
+    activity_noise(_ctx, p, ACTIVITY_DORMANT_DIST);
     
     // Spawn gib particles
     for (int i = 0; i < 4; i++) {
@@ -52,15 +55,17 @@ void entity_barrel_t::_explode() {
     }
     
     // Spawn explosion light
-    auto light = game_spawn<entity_light_t>(p + vec3(0, 16, 0));
-    float intensity = 250.0f;
-    int color = 0x0088ff;
-    light->_init(&intensity, &color);
-    light->_die_at = game_time + 0.2f;
+    auto light = game_spawn<entity_light_t>(_ctx, p + vec3(0, 16, 0));
+    if (light) {
+        float intensity = 250.0f;
+        int color = 0x0088ff;
+        light->_init(&intensity, &color);
+        light->_die_at = _ctx->time + 0.2f;
+    }
     
     // Remove from enemy list
-    game_entities_enemies.erase(
-        std::remove(game_entities_enemies.begin(), game_entities_enemies.end(), shared_from_this()),
-        game_entities_enemies.end()
+    _ctx->entities_enemies.erase(
+        std::remove(_ctx->entities_enemies.begin(), _ctx->entities_enemies.end(), shared_from_this()),
+        _ctx->entities_enemies.end()
     );
 }
\ No newline at end of file
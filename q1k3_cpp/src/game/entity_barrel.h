@@ -5,10 +5,10 @@
 
 class entity_barrel_t : public entity_t {
 public:
-    entity_barrel_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_barrel_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     
     void _init(void* p1, void* p2) override;
-    void _update() override;
+    bool _at_rest() override;
     void _kill() override;
     void _explode();
 };
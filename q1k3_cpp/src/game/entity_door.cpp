@@ -3,12 +3,13 @@
 #include "game.h"
 #include "../renderer/renderer.h"
 #include <algorithm>
+#include <cmath>
 
 // Model stub
 static model_t* model_door = nullptr;
 
-entity_door_t::entity_door_t(const vec3& pos, void* p1, void* p2) 
-    : entity_t(pos, p1, p2), _key(0), _open_at(0), _target(), _start() {
+entity_door_t::entity_door_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2) 
+    : entity_t(ctx, pos, p1, p2), _needs_key(false), _player_near(false), _open(0), _reset_state_at(0), _start() {
 }
 
 void entity_door_t::_init(void* p1, void* p2) {
@@ -19,40 +20,70 @@ void entity_door_t::_init(void* p1, void* p2) {
     _texture = texture;
     _health = 10;
     s = vec3(64, 64, 64);
+    _gravity = 0;
+    _activity_lod = true;
     _start = vec3_clone(p);
     
-    _open_at = 0;
+    _reset_state_at = 0;
     _yaw = dir * M_PI/2;
-    _key = 0;  // 0 = closed, 1 = open
+    _open = 0;
     
     // Map 1 only has one door and it needs a key
-    bool needs_key = (game_map_index == 0);  // Note: JS uses 1-based, C++ uses 0-based
+    _needs_key = (_ctx->map_index == 0);  // Note: JS uses 1-based, C++ uses 0-based
     
-    // Doors block enemies and players
-    game_entities_enemies.push_back(shared_from_this());
-    game_entities_friendly.push_back(shared_from_this());
+    // Doors block enemies and players through the collision overlay and
+    // open when the player comes within 128 units
+    _trigger = trigger_add(_ctx, this, p, 128);
+    _update_solid();
+}
+
+// Block the cells covered by the door panel, 128 units wide and high and
+// 16 thick, turned by _yaw. Only touches the overlay when the door has
+// moved into other cells.
+void entity_door_t::_update_solid() {
+    vec3 half = vec3_rotate_y(vec3(64, 64, 8), _yaw);
+    half = vec3(std::abs(half.x), std::abs(half.y), std::abs(half.z));
+    map_mover_move(&_ctx->overlay, &_solid, p - half, p + half);
+    trigger_move(_ctx, _trigger, p);
+}
+
+void entity_door_t::_trigger_enter(entity_t* /*other*/) {
+    if (_needs_key) {
+        game_show_message(_ctx, "YOU NEED THE KEY...");
+        return;
+    }
+    _player_near = true;
+    activity_wake(this);
+}
+
+void entity_door_t::_trigger_exit(entity_t* /*other*/) {
+    _player_near = false;
 }
 
 void entity_door_t::_update() {
-    _draw_model();
-    
-    if (game_entity_player && vec3_dist(p, game_entity_player->p) < 128) {
-        if (_key == 0) {  // If door needs key and is closed
-            game_show_message("YOU NEED THE KEY...");
-            return;
-        }
-        _open_at = game_time + 3;
+    // Stay open for 3 seconds after the player left
+    if (_player_near) {
+        _reset_state_at = _ctx->time + 3;
     }
     
-    float open_amount;
-    if (_open_at < game_time) {
-        open_amount = std::max(0.0f, static_cast<float>(_key) - game_tick);
+    if (_reset_state_at < _ctx->time) {
+        _open = std::max(0.0f, _open - _ctx->tick);
     } else {
-        open_amount = std::min(1.0f, static_cast<float>(_key) + game_tick);
+        _open = std::min(1.0f, _open + _ctx->tick);
     }
-    _key = static_cast<int>(open_amount);
     
-    p = _start + vec3_rotate_y(vec3(96 * open_amount, 0, 0), _yaw);
+    p = _start + vec3_rotate_y(vec3(96 * _open, 0, 0), _yaw);
+    _update_solid();
+}
+
+// Closed doors sleep until the player comes close
+bool entity_door_t::_at_rest() {
+    return _open == 0 && _reset_state_at < _ctx->time && !_player_near;
+}
+
+void entity_door_t::_kill() {
+    map_mover_remove(&_ctx->overlay, &_solid);
+    entity_t::_kill();
 }
 
 void entity_door_t::_did_collide_with_entity(EntityPtr other) {
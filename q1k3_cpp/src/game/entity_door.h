@@ -5,16 +5,24 @@
 
 class entity_door_t : public entity_t {
 private:
-    int _key;
-    float _open_at;
-    vec3 _target;
+    bool _needs_key;
+    bool _player_near;
+    float _open;          // 0 = closed, 1 = open
+    float _reset_state_at;
     vec3 _start;
+    map_mover_t _solid;   // cells blocked in _ctx->overlay
+    
+    void _update_solid();
     
 public:
-    entity_door_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_door_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     
     void _init(void* p1, void* p2) override;
     void _update() override;
+    bool _at_rest() override;
+    void _trigger_enter(entity_t* other) override;
+    void _trigger_exit(entity_t* other) override;
+    void _kill() override;
     void _did_collide_with_entity(EntityPtr other) override;
 };
 
@@ -1,8 +1,9 @@
 #include "entity_enemy.h"
-#include "entity_projectile.h"
+#include "projectile.h"
 #include "entity_player.h"
 #include "game.h"
 #include "weapons.h"
+#include "hitscan.h"
 #include "../renderer/renderer.h"
 #include "../assets/map.h"
 #include <cmath>
@@ -29,8 +30,8 @@ static void* sfx_hound_attack = nullptr;
 // map_trace is defined in map.cpp
 
 // Base enemy implementation
-entity_enemy_t::entity_enemy_t(const vec3& pos, void* p1, void* p2) 
-    : entity_t(pos, p1, p2) {
+entity_enemy_t::entity_enemy_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2) 
+    : entity_t(ctx, pos, p1, p2) {
     
     // Initialize animations
     _ANIMS = {
@@ -65,16 +66,18 @@ void entity_enemy_t::_init(void* p1, void* p2) {
     _attack_chance = 0.65f;
     _keep_off_ledges = true;
     _turn_bias = 1;
+    _attack_pending = false;
     
     _check_against = ENTITY_GROUP_PLAYER;
+    _activity_lod = true;
     
-    game_entities_enemies.push_back(shared_from_this());
+    _ctx->entities_enemies.push_back(shared_from_this());
     
     // Set initial state based on patrol direction
     if (patrol_dir) {
         _set_state(&_STATE_PATROL);
         _target_yaw = (M_PI/2) * patrol_dir;
-        _anim_time = static_cast<float>(rand()) / RAND_MAX;
+        _anim_time = _random();
     } else {
         _set_state(&_STATE_IDLE);
     }
@@ -84,20 +87,27 @@ void entity_enemy_t::_set_state(enemy_state_t* state) {
     _state = state;
     _anim = _ANIMS[state->anim_index];
     _anim_time = 0;
-    _state_update_at = game_time + state->next_state_update + 
-                      state->next_state_update/4 * (static_cast<float>(rand()) / RAND_MAX);
+    _state_update_at = _ctx->time + state->next_state_update + 
+                      state->next_state_update/4 * _random();
 }
 
-void entity_enemy_t::_update() {
-    if (_state_update_at < game_time) {
-        _turn_bias = (static_cast<float>(rand()) / RAND_MAX) > 0.5f ? 0.5f : -0.5f;
+// The state update below looks for the player
+bool entity_enemy_t::_needs_los() {
+    return _state_update_at < _ctx->time;
+}
+
+// AI decisions; runs in parallel with all other entities, so anything that
+// affects the rest of the world (attacks) is deferred to _update()
+void entity_enemy_t::_think() {
+    if (_state_update_at < _ctx->time) {
+        _turn_bias = _random() > 0.5f ? 0.5f : -0.5f;
         
-        if (!game_entity_player || game_entity_player->_dead) {
+        if (!_ctx->entity_player || _ctx->entity_player->_dead) {
             return;
         }
         
-        float distance_to_player = vec3_dist(p, game_entity_player->p);
-        float angle_to_player = vec3_2d_angle(p, game_entity_player->p);
+        float distance_to_player = vec3_dist(p, _ctx->entity_player->p);
+        float angle_to_player = vec3_2d_angle(p, _ctx->entity_player->p);
         
         if (_state->next_state) {
             _set_state(_state->next_state);
@@ -105,15 +115,19 @@ void entity_enemy_t::_update() {
         
         // State logic
         if (_state == &_STATE_FOLLOW) {
-            if (!map_trace(p, game_entity_player->p)) {
+            // Walk straight at the player if visible, otherwise follow the
+            // flow field around the walls
+            if (los_player_visible(_ctx, p)) {
                 _target_yaw = angle_to_player;
+            } else {
+                nav_yaw_to_player(_ctx, p, s.y, &_target_yaw);
             }
             
             if (distance_to_player < _attack_distance) {
                 if (distance_to_player < _evade_distance || 
-                    (static_cast<float>(rand()) / RAND_MAX) > _attack_chance) {
+                    _random() > _attack_chance) {
                     _set_state(&_STATE_EVADE);
-                    _target_yaw += M_PI/2 + (static_cast<float>(rand()) / RAND_MAX) * M_PI;
+                    _target_yaw += M_PI/2 + _random() * M_PI;
                 } else {
                     _set_state(&_STATE_ATTACK_AIM);
                 }
@@ -125,22 +139,29 @@ void entity_enemy_t::_update() {
         }
         
         if (_state == &_STATE_PATROL || _state == &_STATE_IDLE) {
-            if (distance_to_player < 700 && !map_trace(p, game_entity_player->p)) {
+            if (distance_to_player < 700 && los_player_visible(_ctx, p)) {
                 _set_state(&_STATE_ATTACK_AIM);
             }
         }
         
         if (_state == &_STATE_ATTACK_AIM) {
             _target_yaw = angle_to_player;
-            if (map_trace(p, game_entity_player->p)) {
+            if (!los_player_visible(_ctx, p)) {
                 _set_state(&_STATE_EVADE);
             }
         }
         
         if (_state == &_STATE_ATTACK_EXEC) {
-            _attack();
+            _attack_pending = true;
         }
     }
+}
+
+void entity_enemy_t::_update() {
+    if (_attack_pending) {
+        _attack_pending = false;
+        _attack();
+    }
     
     // Rotate to desired angle
     _yaw += anglemod(_target_yaw - _yaw) * 0.1f;
@@ -149,14 +170,15 @@ void entity_enemy_t::_update() {
     if (_on_ground) {
         v = vec3_rotate_y(vec3(0, v.y, _state->speed * _speed), _target_yaw);
     }
-    
-    _update_physics();
-    _draw_model();
 }
 
-EntityPtr entity_enemy_t::_spawn_projectile(int type, float speed, float yaw_offset, float pitch_offset) {
-    // TODO: Implement projectile spawning based on type
-    return nullptr;
+void entity_enemy_t::_spawn_projectile(projectile_type_t type, float speed, float yaw_offset, float pitch_offset) {
+    if (!_ctx->entity_player) {
+        return;
+    }
+    float pitch = std::atan2(p.y - _ctx->entity_player->p.y, vec3_dist(p, _ctx->entity_player->p));
+    vec3 velocity = vec3_rotate_yaw_pitch(vec3(0, 0, speed), _yaw + yaw_offset, pitch + pitch_offset);
+    projectile_spawn(_ctx, type, p, velocity, _yaw + M_PI / 2, 0, ENTITY_GROUP_PLAYER, shared_from_this());
 }
 
 void entity_enemy_t::_receive_damage(EntityPtr from, float amount) {
@@ -164,7 +186,7 @@ void entity_enemy_t::_receive_damage(EntityPtr from, float amount) {
     _play_sound(sfx_enemy_hit);
     
     if (_state == &_STATE_IDLE || _state == &_STATE_PATROL) {
-        _target_yaw = vec3_2d_angle(p, game_entity_player->p);
+        _target_yaw = vec3_2d_angle(p, _ctx->entity_player->p);
         _set_state(&_STATE_FOLLOW);
     }
     
@@ -183,9 +205,9 @@ void entity_enemy_t::_kill() {
     _play_sound(sfx_enemy_gib);
     
     // Remove from enemy list
-    game_entities_enemies.erase(
-        std::remove(game_entities_enemies.begin(), game_entities_enemies.end(), shared_from_this()),
-        game_entities_enemies.end()
+    _ctx->entities_enemies.erase(
+        std::remove(_ctx->entities_enemies.begin(), _ctx->entities_enemies.end(), shared_from_this()),
+        _ctx->entities_enemies.end()
     );
 }
 
@@ -200,8 +222,8 @@ void entity_enemy_t::_did_collide(int axis) {
 }
 
 // Grunt implementation
-entity_enemy_grunt_t::entity_enemy_grunt_t(const vec3& pos, void* p1, void* p2)
-    : entity_enemy_t(pos, p1, p2) {}
+entity_enemy_grunt_t::entity_enemy_grunt_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2)
+    : entity_enemy_t(ctx, pos, p1, p2) {}
 
 void entity_enemy_grunt_t::_init(void* p1, void* p2) {
     entity_enemy_t::_init(p1, p2);
@@ -212,17 +234,26 @@ void entity_enemy_grunt_t::_init(void* p1, void* p2) {
 
 void entity_enemy_grunt_t::_attack() {
     audio_play(sfx_shotgun_shoot);
+    if (!_ctx->entity_player) {
+        return;
+    }
+    
+    // Shotgun pellets are traced, aimed like _spawn_projectile() would
+    float pitch = std::atan2(p.y - _ctx->entity_player->p.y, vec3_dist(p, _ctx->entity_player->p));
+    hitscan_ray_t rays[8];
     for (int i = 0; i < 8; i++) {
         float spread = 0.08f;
-        _spawn_projectile(0, 10000, 
-            (static_cast<float>(rand()) / RAND_MAX) * spread - spread/2,
-            (static_cast<float>(rand()) / RAND_MAX) * spread - spread/2);
+        float yaw_offset = _random() * spread - spread/2;
+        float pitch_offset = _random() * spread - spread/2;
+        rays[i] = {p, vec3_rotate_yaw_pitch(vec3(0, 0, 1), _yaw + yaw_offset, pitch + pitch_offset),
+                   10000 * 0.1f};
     }
+    hitscan_fire(_ctx, rays, 8, ENTITY_GROUP_PLAYER, shared_from_this(), 4);
 }
 
 // Enforcer implementation
-entity_enemy_enforcer_t::entity_enemy_enforcer_t(const vec3& pos, void* p1, void* p2)
-    : entity_enemy_t(pos, p1, p2) {}
+entity_enemy_enforcer_t::entity_enemy_enforcer_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2)
+    : entity_enemy_t(ctx, pos, p1, p2) {}
 
 void entity_enemy_enforcer_t::_init(void* p1, void* p2) {
     entity_enemy_t::_init(p1, p2);
@@ -234,12 +265,12 @@ void entity_enemy_enforcer_t::_init(void* p1, void* p2) {
 
 void entity_enemy_enforcer_t::_attack() {
     audio_play(sfx_plasma_shoot);
-    _spawn_projectile(1, 700, 0, 0);
+    _spawn_projectile(PROJECTILE_PLASMA, 700, 0, 0);
 }
 
 // Ogre implementation
-entity_enemy_ogre_t::entity_enemy_ogre_t(const vec3& pos, void* p1, void* p2)
-    : entity_enemy_t(pos, p1, p2) {}
+entity_enemy_ogre_t::entity_enemy_ogre_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2)
+    : entity_enemy_t(ctx, pos, p1, p2) {}
 
 void entity_enemy_ogre_t::_init(void* p1, void* p2) {
     entity_enemy_t::_init(p1, p2);
@@ -250,12 +281,12 @@ void entity_enemy_ogre_t::_init(void* p1, void* p2) {
 
 void entity_enemy_ogre_t::_attack() {
     audio_play(sfx_grenade_shoot);
-    _spawn_projectile(2, 600, 0, -0.4f);
+    _spawn_projectile(PROJECTILE_GRENADE, 600, 0, -0.4f);
 }
 
 // Zombie implementation
-entity_enemy_zombie_t::entity_enemy_zombie_t(const vec3& pos, void* p1, void* p2)
-    : entity_enemy_t(pos, p1, p2) {}
+entity_enemy_zombie_t::entity_enemy_zombie_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2)
+    : entity_enemy_t(ctx, pos, p1, p2) {}
 
 void entity_enemy_zombie_t::_init(void* p1, void* p2) {
     entity_enemy_t::_init(p1, p2);
@@ -268,14 +299,14 @@ void entity_enemy_zombie_t::_init(void* p1, void* p2) {
 
 void entity_enemy_zombie_t::_attack() {
     audio_play(sfx_zombie_hit);
-    if (game_entity_player) {
-        game_entity_player->_receive_damage(shared_from_this(), 10);
+    if (_ctx->entity_player) {
+        _ctx->entity_player->_receive_damage(shared_from_this(), 10);
     }
 }
 
 // Hound implementation
-entity_enemy_hound_t::entity_enemy_hound_t(const vec3& pos, void* p1, void* p2)
-    : entity_enemy_t(pos, p1, p2) {}
+entity_enemy_hound_t::entity_enemy_hound_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2)
+    : entity_enemy_t(ctx, pos, p1, p2) {}
 
 void entity_enemy_hound_t::_init(void* p1, void* p2) {
     entity_enemy_t::_init(p1, p2);
@@ -289,7 +320,7 @@ void entity_enemy_hound_t::_init(void* p1, void* p2) {
 
 void entity_enemy_hound_t::_attack() {
     audio_play(sfx_hound_attack);
-    if (game_entity_player) {
-        game_entity_player->_receive_damage(shared_from_this(), 10);
+    if (_ctx->entity_player) {
+        _ctx->entity_player->_receive_damage(shared_from_this(), 10);
     }
 }
\ No newline at end of file
@@ -35,16 +35,19 @@ protected:
     float _evade_distance;
     float _attack_chance;
     float _turn_bias;
+    bool _attack_pending;
     
     enemy_state_t* _state;
     
     void _set_state(enemy_state_t* state);
-    EntityPtr _spawn_projectile(int type, float speed, float yaw_offset, float pitch_offset);
+    void _spawn_projectile(projectile_type_t type, float speed, float yaw_offset, float pitch_offset);
     
 public:
-    entity_enemy_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_enemy_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     
     void _init(void* p1, void* p2) override;
+    void _think() override;
+    bool _needs_los() override;
     void _update() override;
     void _receive_damage(EntityPtr from, float amount) override;
     void _kill() override;
@@ -56,7 +59,7 @@ public:
 // Grunt enemy
 class entity_enemy_grunt_t : public entity_enemy_t {
 public:
-    entity_enemy_grunt_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_enemy_grunt_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     void _init(void* p1, void* p2) override;
     void _attack() override;
 };
@@ -64,7 +67,7 @@ public:
 // Enforcer enemy  
 class entity_enemy_enforcer_t : public entity_enemy_t {
 public:
-    entity_enemy_enforcer_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_enemy_enforcer_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     void _init(void* p1, void* p2) override;
     void _attack() override;
 };
@@ -72,7 +75,7 @@ public:
 // Ogre enemy
 class entity_enemy_ogre_t : public entity_enemy_t {
 public:
-    entity_enemy_ogre_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_enemy_ogre_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     void _init(void* p1, void* p2) override;
     void _attack() override;
 };
@@ -80,7 +83,7 @@ public:
 // Zombie enemy
 class entity_enemy_zombie_t : public entity_enemy_t {
 public:
-    entity_enemy_zombie_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_enemy_zombie_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     void _init(void* p1, void* p2) override;
     void _attack() override;
 };
@@ -88,7 +91,7 @@ public:
 // Hound enemy
 class entity_enemy_hound_t : public entity_enemy_t {
 public:
-    entity_enemy_hound_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_enemy_hound_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     void _init(void* p1, void* p2) override;
     void _attack() override;
 };
@@ -1,8 +1,8 @@
 #include "entity_light.h"
 #include "../renderer/renderer.h"
 
-entity_light_t::entity_light_t(const vec3& pos, void* p1, void* p2) 
-    : entity_t(pos, p1, p2), _intensity(1.0f), _color(1, 1, 1) {
+entity_light_t::entity_light_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2) 
+    : entity_t(ctx, pos, p1, p2), _intensity(1.0f), _color(1, 1, 1) {
 }
 
 void entity_light_t::_init(void* p1, void* p2) {
@@ -20,7 +20,7 @@ void entity_light_t::_init(void* p1, void* p2) {
     }
 }
 
-void entity_light_t::_update() {
+void entity_light_t::_draw(float alpha) {
     // Add light to renderer
-    r_push_light(p, _intensity, _color.x, _color.y, _color.z);
+    r_push_light(_draw_pos(alpha), _intensity, _color.x, _color.y, _color.z);
 }
\ No newline at end of file
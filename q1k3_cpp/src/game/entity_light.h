@@ -9,10 +9,10 @@ private:
     vec3 _color;
     
 public:
-    entity_light_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_light_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     
     void _init(void* p1, void* p2) override;
-    void _update() override;
+    void _draw(float alpha) override;
 };
 
 #endif // ENTITY_LIGHT_H
\ No newline at end of file
@@ -5,10 +5,9 @@
 
 class entity_particle_t : public entity_t {
 public:
-    entity_particle_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_particle_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     
     void _init(void* p1, void* p2) override;
-    void _update() override;
 };
 
 #endif // ENTITY_PARTICLE_H
\ No newline at end of file
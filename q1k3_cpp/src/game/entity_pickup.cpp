@@ -15,19 +15,23 @@ static void* sfx_pickup = nullptr;
 static void* sfx_no_ammo_pickup = nullptr;
 
 // Base pickup implementation
-entity_pickup_t::entity_pickup_t(const vec3& pos, void* p1, void* p2) 
-    : entity_t(pos, p1, p2), _bob_offset(), _bob_time(0) {
+entity_pickup_t::entity_pickup_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2) 
+    : entity_t(ctx, pos, p1, p2), _bob_offset(), _bob_time(0) {
+    _activity_lod = true;
+    _trigger = trigger_add(ctx, this, pos, 40);
 }
 
+// Only runs while falling; pickups on the ground sleep
 void entity_pickup_t::_update() {
-    if (!_on_ground) {
-        _update_physics();
-    }
-    _draw_model();
-    
-    if (game_entity_player && vec3_dist(p, game_entity_player->p) < 40) {
-        _pickup(game_entity_player);
-    }
+    trigger_move(_ctx, _trigger, p);
+}
+
+bool entity_pickup_t::_at_rest() {
+    return _on_ground;
+}
+
+void entity_pickup_t::_trigger_enter(entity_t* other) {
+    _pickup(other->shared_from_this());
 }
 
 void entity_pickup_t::_did_collide_with_entity(EntityPtr other) {
@@ -35,8 +39,8 @@ void entity_pickup_t::_did_collide_with_entity(EntityPtr other) {
 }
 
 // Health pickup
-entity_pickup_health_t::entity_pickup_health_t(const vec3& pos, void* p1, void* p2)
-    : entity_pickup_t(pos, p1, p2) {}
+entity_pickup_health_t::entity_pickup_health_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2)
+    : entity_pickup_t(ctx, pos, p1, p2) {}
 
 void entity_pickup_health_t::_init(void* /*p1*/, void* /*p2*/) {
     _model = model_pickup_box;
@@ -47,22 +51,24 @@ void entity_pickup_health_t::_init(void* /*p1*/, void* /*p2*/) {
 
 void entity_pickup_health_t::_pickup(EntityPtr other) {
     other->_health = std::min(other->_health + 25.0f, 100.0f);
-    game_show_message("HEALTH");
+    game_show_message(_ctx, "HEALTH");
     audio_play(sfx_pickup);
     
     // Spawn light effect
-    auto light = game_spawn<entity_light_t>(p);
-    float intensity = 0.5f;
-    int color = 0x00ff00;
-    light->_init(&intensity, &color);
-    light->_die_at = game_time + 0.1f;
+    auto light = game_spawn<entity_light_t>(_ctx, p);
+    if (light) {
+        float intensity = 0.5f;
+        int color = 0x00ff00;
+        light->_init(&intensity, &color);
+        light->_die_at = _ctx->time + 0.1f;
+    }
     
     _kill();
 }
 
 // Nailgun pickup
-entity_pickup_nailgun_t::entity_pickup_nailgun_t(const vec3& pos, void* p1, void* p2)
-    : entity_pickup_t(pos, p1, p2) {}
+entity_pickup_nailgun_t::entity_pickup_nailgun_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2)
+    : entity_pickup_t(ctx, pos, p1, p2) {}
 
 void entity_pickup_nailgun_t::_init(void* /*p1*/, void* /*p2*/) {
     _model = model_nailgun;
@@ -72,21 +78,23 @@ void entity_pickup_nailgun_t::_init(void* /*p1*/, void* /*p2*/) {
 
 void entity_pickup_nailgun_t::_pickup(EntityPtr other) {
     // Assuming player has weapon system - would need proper casting
-    game_show_message("NAILGUN");
+    game_show_message(_ctx, "NAILGUN");
     audio_play(sfx_pickup);
     
-    auto light = game_spawn<entity_light_t>(p);
-    float intensity = 0.5f;
-    int color = 0x0000ff;
-    light->_init(&intensity, &color);
-    light->_die_at = game_time + 0.1f;
+    auto light = game_spawn<entity_light_t>(_ctx, p);
+    if (light) {
+        float intensity = 0.5f;
+        int color = 0x0000ff;
+        light->_init(&intensity, &color);
+        light->_die_at = _ctx->time + 0.1f;
+    }
     
     _kill();
 }
 
 // Grenade launcher pickup
-entity_pickup_grenadelauncher_t::entity_pickup_grenadelauncher_t(const vec3& pos, void* p1, void* p2)
-    : entity_pickup_t(pos, p1, p2) {}
+entity_pickup_grenadelauncher_t::entity_pickup_grenadelauncher_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2)
+    : entity_pickup_t(ctx, pos, p1, p2) {}
 
 void entity_pickup_grenadelauncher_t::_init(void* /*p1*/, void* /*p2*/) {
     _model = model_grenadelauncher;
@@ -95,21 +103,23 @@ void entity_pickup_grenadelauncher_t::_init(void* /*p1*/, void* /*p2*/) {
 }
 
 void entity_pickup_grenadelauncher_t::_pickup(EntityPtr other) {
-    game_show_message("GRENADE LAUNCHER");
+    game_show_message(_ctx, "GRENADE LAUNCHER");
     audio_play(sfx_pickup);
     
-    auto light = game_spawn<entity_light_t>(p);
-    float intensity = 0.5f;
-    int color = 0xff0000;
-    light->_init(&intensity, &color);
-    light->_die_at = game_time + 0.1f;
+    auto light = game_spawn<entity_light_t>(_ctx, p);
+    if (light) {
+        float intensity = 0.5f;
+        int color = 0xff0000;
+        light->_init(&intensity, &color);
+        light->_die_at = _ctx->time + 0.1f;
+    }
     
     _kill();
 }
 
 // Nails ammo pickup
-entity_pickup_nails_t::entity_pickup_nails_t(const vec3& pos, void* p1, void* p2)
-    : entity_pickup_t(pos, p1, p2) {}
+entity_pickup_nails_t::entity_pickup_nails_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2)
+    : entity_pickup_t(ctx, pos, p1, p2) {}
 
 void entity_pickup_nails_t::_init(void* /*p1*/, void* /*p2*/) {
     _model = model_pickup_box;
@@ -120,14 +130,14 @@ void entity_pickup_nails_t::_init(void* /*p1*/, void* /*p2*/) {
 
 void entity_pickup_nails_t::_pickup(EntityPtr other) {
     // Would need to check if player has nailgun and add ammo
-    game_show_message("NAILS");
+    game_show_message(_ctx, "NAILS");
     audio_play(sfx_pickup);
     _kill();
 }
 
 // Grenades ammo pickup
-entity_pickup_grenades_t::entity_pickup_grenades_t(const vec3& pos, void* p1, void* p2)
-    : entity_pickup_t(pos, p1, p2) {}
+entity_pickup_grenades_t::entity_pickup_grenades_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2)
+    : entity_pickup_t(ctx, pos, p1, p2) {}
 
 void entity_pickup_grenades_t::_init(void* /*p1*/, void* /*p2*/) {
     _model = model_pickup_box;
@@ -138,14 +148,14 @@ void entity_pickup_grenades_t::_init(void* /*p1*/, void* /*p2*/) {
 
 void entity_pickup_grenades_t::_pickup(EntityPtr other) {
     // Would need to check if player has grenade launcher and add ammo
-    game_show_message("GRENADES");
+    game_show_message(_ctx, "GRENADES");
     audio_play(sfx_pickup);
     _kill();
 }
 
 // Key pickup
-entity_pickup_key_t::entity_pickup_key_t(const vec3& pos, void* p1, void* p2)
-    : entity_pickup_t(pos, p1, p2) {}
+entity_pickup_key_t::entity_pickup_key_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2)
+    : entity_pickup_t(ctx, pos, p1, p2) {}
 
 void entity_pickup_key_t::_init(void* /*p1*/, void* /*p2*/) {
     _model = model_pickup_key;
@@ -155,14 +165,16 @@ void entity_pickup_key_t::_init(void* /*p1*/, void* /*p2*/) {
 
 void entity_pickup_key_t::_pickup(EntityPtr other) {
     // Would need to add key to player inventory
-    game_show_message("KEY");
+    game_show_message(_ctx, "KEY");
     audio_play(sfx_pickup);
     
-    auto light = game_spawn<entity_light_t>(p);
-    float intensity = 0.5f;
-    int color = 0xffff00;
-    light->_init(&intensity, &color);
-    light->_die_at = game_time + 0.1f;
+    auto light = game_spawn<entity_light_t>(_ctx, p);
+    if (light) {
+        float intensity = 0.5f;
+        int color = 0xffff00;
+        light->_init(&intensity, &color);
+        light->_die_at = _ctx->time + 0.1f;
+    }
     
     _kill();
 }
\ No newline at end of file
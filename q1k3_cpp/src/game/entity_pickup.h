@@ -10,9 +10,11 @@ protected:
     float _bob_time;
     
 public:
-    entity_pickup_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_pickup_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     
     void _update() override;
+    bool _at_rest() override;
+    void _trigger_enter(entity_t* other) override;
     void _did_collide_with_entity(EntityPtr other) override;
     virtual void _pickup(EntityPtr other) = 0;
 };
@@ -20,7 +22,7 @@ public:
 // Health pickup
 class entity_pickup_health_t : public entity_pickup_t {
 public:
-    entity_pickup_health_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_pickup_health_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     void _init(void* p1, void* p2) override;
     void _pickup(EntityPtr other) override;
 };
@@ -28,7 +30,7 @@ public:
 // Nailgun pickup
 class entity_pickup_nailgun_t : public entity_pickup_t {
 public:
-    entity_pickup_nailgun_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_pickup_nailgun_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     void _init(void* p1, void* p2) override;
     void _pickup(EntityPtr other) override;
 };
@@ -36,7 +38,7 @@ public:
 // Grenadelauncher pickup
 class entity_pickup_grenadelauncher_t : public entity_pickup_t {
 public:
-    entity_pickup_grenadelauncher_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_pickup_grenadelauncher_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     void _init(void* p1, void* p2) override;
     void _pickup(EntityPtr other) override;
 };
@@ -44,7 +46,7 @@ public:
 // Nails ammo pickup
 class entity_pickup_nails_t : public entity_pickup_t {
 public:
-    entity_pickup_nails_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_pickup_nails_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     void _init(void* p1, void* p2) override;
     void _pickup(EntityPtr other) override;
 };
@@ -52,7 +54,7 @@ public:
 // Grenades ammo pickup
 class entity_pickup_grenades_t : public entity_pickup_t {
 public:
-    entity_pickup_grenades_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_pickup_grenades_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     void _init(void* p1, void* p2) override;
     void _pickup(EntityPtr other) override;
 };
@@ -60,7 +62,7 @@ public:
 // Key pickup
 class entity_pickup_key_t : public entity_pickup_t {
 public:
-    entity_pickup_key_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_pickup_key_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     void _init(void* p1, void* p2) override;
     void _pickup(EntityPtr other) override;
 };
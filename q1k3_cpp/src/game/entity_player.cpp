@@ -10,8 +10,8 @@
 #include <algorithm>
 #include <iostream>
 
-entity_player_t::entity_player_t(const vec3& pos, void* p1, void* p2) 
-    : entity_t(pos, p1, p2), _speed(3000), _can_jump(false), _can_shoot_at(0),
+entity_player_t::entity_player_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2) 
+    : entity_t(ctx, pos, p1, p2), _speed(3000), _can_jump(false), _can_shoot_at(0),
       _weapon_index(0), _bob(0) {
 }
 
@@ -26,44 +26,44 @@ void entity_player_t::_init(void* p1, void* p2) {
     _weapons.push_back(std::make_unique<weapon_shotgun_t>());
     
     // Map 1 needs some rotation of the starting look-at direction
-    _yaw += game_map_index * M_PI;
+    _yaw += _ctx->map_index * M_PI;
     
-    game_entity_player = std::static_pointer_cast<entity_player_t>(shared_from_this());
-    game_entities_friendly.push_back(shared_from_this());
+    _ctx->entity_player = std::static_pointer_cast<entity_player_t>(shared_from_this());
+    _ctx->entities_friendly.push_back(shared_from_this());
 }
 
 void entity_player_t::_update() {
     // Mouse look
     float mouse_sensitivity = 0.00015f; // TODO: Get from settings
-    _pitch = clamp(_pitch + g_input->get_mouse_y() * mouse_sensitivity, -1.5f, 1.5f);
-    _yaw = std::fmod(_yaw + g_input->get_mouse_x() * mouse_sensitivity, M_PI * 2);
+    _pitch = clamp(_pitch + _ctx->input->get_mouse_y() * mouse_sensitivity, -1.5f, 1.5f);
+    _yaw = std::fmod(_yaw + _ctx->input->get_mouse_x() * mouse_sensitivity, M_PI * 2);
     
     // Acceleration in movement direction
     vec3 move_input(
-        g_input->get_move_x(),
+        _ctx->input->get_move_x(),
         0,
-        -g_input->get_move_z()  // Negative because forward is -Z
+        -_ctx->input->get_move_z()  // Negative because forward is -Z
     );
     
     a = vec3_rotate_y(move_input, _yaw) * (_speed * (_on_ground ? 1.0f : 0.3f));
     
     // Jump
-    if (g_input->is_key_down(KEY_JUMP) && _on_ground && _can_jump) {
+    if (_ctx->input->is_key_down(KEY_JUMP) && _on_ground && _can_jump) {
         v.y = 400;
         _on_ground = false;
         _can_jump = false;
     }
-    if (!g_input->is_key_down(KEY_JUMP)) {
+    if (!_ctx->input->is_key_down(KEY_JUMP)) {
         _can_jump = true;
     }
     
     // Weapon switching
-    int weapon_switch = g_input->get_weapon_switch();
+    int weapon_switch = _ctx->input->get_weapon_switch();
     if (weapon_switch != 0) {
         _weapon_index = (_weapon_index + weapon_switch + _weapons.size()) % _weapons.size();
     }
     
-    float shoot_wait = _can_shoot_at - game_time;
+    float shoot_wait = _can_shoot_at - _ctx->time;
     
     // Safety check for weapons
     if (_weapon_index >= _weapons.size() || !_weapons[_weapon_index]) {
@@ -73,30 +73,47 @@ void entity_player_t::_update() {
     weapon_t* weapon = _weapons[_weapon_index].get();
     
     // Shoot weapon
-    if (g_input->is_key_down(KEY_ACTION) && shoot_wait < 0) {
-        _can_shoot_at = game_time + weapon->_reload;
+    if (_ctx->input->is_key_down(KEY_ACTION) && shoot_wait < 0) {
+        _can_shoot_at = _ctx->time + weapon->_reload;
         
         if (weapon->_needs_ammo && weapon->_ammo == 0) {
             audio_play(sfx_no_ammo);
         } else {
-            weapon->_shoot(p, _yaw, _pitch);
+            weapon->_shoot(_ctx, p, _yaw, _pitch);
+            activity_noise(_ctx, p, ACTIVITY_DORMANT_DIST);
             // Spawn muzzle flash
-            auto light = game_spawn<entity_light_t>(p);
-            light->_die_at = game_time + 0.1f;
+            auto light = game_spawn<entity_light_t>(_ctx, p);
+            if (light) {
+                light->_die_at = _ctx->time + 0.1f;
+            }
         }
     }
     
     // Update physics
     _bob += vec3_length(a) * 0.0001f;
     f = _on_ground ? 10.0f : 2.5f;
-    _update_physics();
+    
+    // Sounds are heard from here
+    _ctx->camera = p + vec3(0, 8, 0);
+    _ctx->camera_yaw = _yaw;
+    _ctx->camera_pitch = _pitch;
+}
+
+void entity_player_t::_draw(float alpha) {
+    if (_weapon_index >= _weapons.size() || !_weapons[_weapon_index]) {
+        return;
+    }
+    
+    weapon_t* weapon = _weapons[_weapon_index].get();
+    float shoot_wait = _can_shoot_at - _ctx->time;
     
     // Update camera
-    r_camera.x = p.x;
-    r_camera.z = p.z;
+    vec3 pos = _draw_pos(alpha);
+    r_camera.x = pos.x;
+    r_camera.z = pos.z;
     
     // Smooth step up on stairs
-    r_camera.y = p.y + 8 - clamp(game_time - _stepped_up_at, 0.0f, 0.1f) * -160;
+    r_camera.y = pos.y + 8 - clamp(_ctx->time - _stepped_up_at, 0.0f, 0.1f) * -160;
     
     r_camera_yaw = _yaw;
     r_camera_pitch = _pitch;
@@ -112,10 +129,9 @@ void entity_player_t::_update() {
     
     // Safety check for model
     if (weapon->_model && !weapon->_model->f.empty()) {
-        r_draw(weapon_pos,
-               _yaw + M_PI/2, _pitch,
-               weapon->_texture, weapon->_model->f[0], weapon->_model->f[0], 0,
-               weapon->_model->nv);
+        r_draw_model(weapon_pos,
+                     _yaw + M_PI/2, _pitch,
+                     weapon->_texture, weapon->_model, 0, 0, 0);
     }
     
     // Update UI
@@ -134,5 +150,6 @@ void entity_player_t::_kill() {
     UI::show_title_screen("YOU DIED");
     
     // Respawn after 2 seconds
-    setTimeout([](){ game_init(game_map_index); }, 2000);
+    game_context_t* ctx = _ctx;
+    setTimeout(ctx, [ctx](){ game_init(ctx, ctx->map_index); }, 2000);
 }
\ No newline at end of file
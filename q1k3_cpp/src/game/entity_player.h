@@ -16,10 +16,11 @@ private:
     float _bob;
     
 public:
-    entity_player_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_player_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     
     void _init(void* p1, void* p2) override;
     void _update() override;
+    void _draw(float alpha) override;
     void _receive_damage(EntityPtr from, float amount) override;
     void _kill() override;
 };
@@ -7,11 +7,8 @@
 // Model stub
 static model_t* model_torch = nullptr;
 
-// Map trace function declaration
-extern bool map_trace(const vec3& from, const vec3& to);
-
-entity_torch_t::entity_torch_t(const vec3& pos, void* p1, void* p2) 
-    : entity_t(pos, p1, p2) {
+entity_torch_t::entity_torch_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2) 
+    : entity_t(ctx, pos, p1, p2) {
 }
 
 void entity_torch_t::_init(void* /*p1*/, void* /*p2*/) {
@@ -34,7 +31,7 @@ void entity_torch_t::_init(void* /*p1*/, void* /*p2*/) {
     
     for (const vec3& trace_dir : trace_dirs) {
         vec3 trace_end = p + trace_dir;
-        if (map_trace(p, trace_end)) {
+        if (map_trace(_ctx->map, p, trace_end)) {
             p = p + trace_dir * 0.4f;
             light_pos = p - trace_dir * 2.0f;
             break;
@@ -45,18 +42,18 @@ void entity_torch_t::_init(void* /*p1*/, void* /*p2*/) {
     // For now, just use offset from position
 }
 
-void entity_torch_t::_update() {
-    entity_t::_update();
+void entity_torch_t::_draw(float alpha) {
+    entity_t::_draw(alpha);
     
     float light_flicker = 0;
-    if (static_cast<float>(rand()) / RAND_MAX > 0.8f) {
-        light_flicker = static_cast<float>(rand()) / RAND_MAX;
+    if (_random() > 0.8f) {
+        light_flicker = _random();
     }
     
     // Calculate light position (offset from torch position)
-    vec3 light_pos = p + vec3(0, 0, 0);  // Would need proper offset based on wall
+    vec3 light_pos = _draw_pos(alpha) + vec3(0, 0, 0);  // Would need proper offset based on wall
     
     r_push_light(light_pos, 
-                 std::sin(game_time) + light_flicker + 6, 
+                 std::sin(_ctx->time) + light_flicker + 6, 
                  1.0f, 0.75f, 0.0625f);  // RGB: 255,192,16 normalized
 }
\ No newline at end of file
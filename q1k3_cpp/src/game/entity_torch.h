@@ -5,10 +5,10 @@
 
 class entity_torch_t : public entity_t {
 public:
-    entity_torch_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_torch_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     
     void _init(void* p1, void* p2) override;
-    void _update() override;
+    void _draw(float alpha) override;
 };
 
 #endif // ENTITY_TORCH_H
\ No newline at end of file
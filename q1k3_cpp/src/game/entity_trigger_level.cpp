@@ -2,26 +2,23 @@
 #include "entity_player.h"
 #include "game.h"
 
-entity_trigger_level_t::entity_trigger_level_t(const vec3& pos, void* p1, void* p2) 
-    : entity_t(pos, p1, p2) {
+entity_trigger_level_t::entity_trigger_level_t(game_context_t* ctx, const vec3& pos, void* p1, void* p2) 
+    : entity_t(ctx, pos, p1, p2) {
 }
 
 void entity_trigger_level_t::_init(void* /*p1*/, void* /*p2*/) {
     // Trigger has no visual representation
     s = vec3(64, 64, 64);  // Trigger volume size
+    _gravity = 0;
+    _activity_lod = true;
+    _trigger = trigger_add(_ctx, this, p, 64);
 }
 
-void entity_trigger_level_t::_update() {
-    if (!_dead && game_entity_player && vec3_dist(p, game_entity_player->p) < 64) {
-        game_next_level();
-        _dead = true;
-    }
+bool entity_trigger_level_t::_at_rest() {
+    return true;
 }
 
-void entity_trigger_level_t::_did_collide_with_entity(EntityPtr other) {
-    // Only trigger for player
-    if (!_dead && other == game_entity_player) {
-        game_next_level();
-        _dead = true;
-    }
+void entity_trigger_level_t::_trigger_enter(entity_t* /*other*/) {
+    game_next_level(_ctx);
+    _kill();
 }
\ No newline at end of file
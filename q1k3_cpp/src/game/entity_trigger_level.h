@@ -5,11 +5,11 @@
 
 class entity_trigger_level_t : public entity_t {
 public:
-    entity_trigger_level_t(const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
+    entity_trigger_level_t(game_context_t* ctx, const vec3& pos, void* p1 = nullptr, void* p2 = nullptr);
     
     void _init(void* p1, void* p2) override;
-    void _update() override;
-    void _did_collide_with_entity(EntityPtr other) override;
+    bool _at_rest() override;
+    void _trigger_enter(entity_t* other) override;
 };
 
 #endif // ENTITY_TRIGGER_LEVEL_H
\ No newline at end of file
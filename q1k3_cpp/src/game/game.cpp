@@ -2,7 +2,14 @@
 #include "entity.h"
 #include "entity_player.h"  // Add this include to fix incomplete type error
 #include "timer.h"
-#include "../platform/platform.h"
+#include "physics.h"
+#include "demo.h"
+#include "activity.h"
+#include "los.h"
+#include "nav.h"
+#include "trigger.h"
+#include "projectile.h"
+#include "../core/jobs.h"
 #include "../platform/input.h"
 #include "../renderer/renderer.h"
 #include "../assets/map.h"
@@ -10,38 +17,67 @@
 #include <iostream>
 
 // Global game variables
-float game_tick = 0;
-float game_time = 0.016f;
 float game_real_time_last = 0;
-int game_message_timeout = 0;
+float game_frame_tick = 0;
 
-std::vector<EntityPtr> game_entities;
-std::vector<EntityPtr> game_entities_enemies;
-std::vector<EntityPtr> game_entities_friendly;
-std::shared_ptr<entity_player_t> game_entity_player;
-int game_map_index = 0;
-bool game_jump_to_next_level = false;
+game_context_t::game_context_t(Input* input)
+    : tick(0), time(0.016f), tick_accumulator(0), tick_index(0),
+      map_index(0), jump_to_next_level(false),
+      map(nullptr), physics(std::make_unique<physics_bodies_t>()), input(input),
+      message_timeout(0), camera_yaw(0), camera_pitch(0),
+      seed_base(0), seed_counter(0) {
+}
+
+game_context_t::~game_context_t() {
+    // Entities give their bodies back on destruction, so they have to go
+    // before the physics world does
+    game_cleanup(this);
+}
 
-void game_init(int map_index) {
+void game_init(game_context_t* ctx, int map_index) {
     // Clear entity lists
-    game_entities.clear();
-    game_entities_enemies.clear();
-    game_entities_friendly.clear();
+    ctx->entities.clear();
+    ctx->entities_enemies.clear();
+    ctx->entities_friendly.clear();
     
-    game_map_index = map_index;
+    ctx->map_index = map_index;
+    map_overlay_clear(&ctx->overlay);
+    trigger_clear(ctx);
+    projectile_clear(ctx);
+    
+    // Timers belong to the entities of the last round
+    ctx->timers.clear();
     
     // Initialize map
-    map_init(map_index);
+    map_init(ctx, map_index);
 }
 
-void game_next_level() {
-    game_jump_to_next_level = true;
+// Start map_index from a well defined state, so the same seed and input
+// always play out the same way (demos)
+void game_reset(game_context_t* ctx, int map_index, uint32_t seed) {
+    ctx->time = 0.016f;
+    ctx->tick_accumulator = 0;
+    ctx->tick_index = 0;
+    ctx->jump_to_next_level = false;
+    ctx->entity_player.reset();
+    ctx->message.clear();
+    ctx->message_timeout = 0;
+    
+    random_seed(&ctx->random, seed, 0);
+    ctx->seed_base = seed;
+    ctx->seed_counter = 0;
+    game_init(ctx, map_index);
 }
 
-void game_show_message(const std::string& text) {
+void game_next_level(game_context_t* ctx) {
+    ctx->jump_to_next_level = true;
+}
+
+void game_show_message(game_context_t* ctx, const std::string& text) {
     // TODO: Implement UI message display
     std::cout << "Game message: " << text << std::endl;
-    game_message_timeout = 2000; // 2 seconds
+    ctx->message = text;
+    ctx->message_timeout = ctx->time + 2; // 2 seconds
 }
 
 void title_show_message(const std::string& msg, const std::string& sub) {
@@ -52,69 +88,159 @@ void title_show_message(const std::string& msg, const std::string& sub) {
     }
 }
 
-void game_update() {
+void game_update(game_context_t* ctx) {
     // Update timers
-    Timer::update(game_time);
+    ctx->timers.update(ctx->time);
+    
+    // The update runs in phases. The parallel ones only ever modify the
+    // entity they are called for and read the rest of the world as it was at
+    // the start of the phase, so the outcome is the same for any number of
+    // threads. Everything else (damage, spawns, sounds, drawing) happens on
+    // this thread, in entity order.
+    std::vector<EntityPtr>& entities = ctx->entities;
+    int num_entities = static_cast<int>(entities.size());
+    uint32_t tick_index = ctx->tick_index;
+    
+    // Far away entities think less often or not at all
+    activity_update(ctx);
     
-    // Update all entities
+    // Trace all line of sight queries of this tick in one go
+    los_update(ctx);
+    nav_update(ctx);
+    
+    // AI decisions (parallel)
+    jobs_parallel_for(num_entities, 16, [&entities, tick_index](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            if (!entities[i]->_dead && activity_due(entities[i].get(), tick_index)) {
+                entities[i]->_think();
+            }
+        }
+    });
+    
+    // Integrate velocities of all physics bodies in one batch
+    physics_integrate(*ctx->physics, ctx->tick);
+    
+    // Expire entities whose time is up
+    for (int i = 0; i < num_entities; i++) {
+        entity_t* entity = entities[i].get();
+        if (!entity->_dead && entity->_die_at && entity->_die_at < ctx->time) {
+            entity->_kill();
+        }
+    }
+    
+    // Move & collide (parallel), against positions from the start of the tick
+    physics_snapshot(*ctx->physics);
+    jobs_parallel_for(num_entities, 16, [&entities](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            if (entities[i]->_activity != ENTITY_DORMANT) {
+                entities[i]->_update_physics();
+            }
+        }
+    });
+    
+    // Pickups, doors & level exits the player walked into or out of
+    trigger_update(ctx);
+    
+    // Nails, grenades, plasma & gibs, one pool at a time
+    projectile_update(ctx);
+    
+    // Apply collisions & update (serial). Entities spawned during this loop
+    // are appended to ctx->entities and updated right away.
     std::vector<EntityPtr> alive_entities;
     
-    for (auto& entity : game_entities) {
+    for (size_t i = 0; i < entities.size(); i++) {
+        EntityPtr entity = entities[i];
         if (entity && !entity->_dead) {
-            entity->_update_physics();
-            entity->_update();
+            entity->_apply_contacts();
+            if (activity_due(entity.get(), tick_index)) {
+                // Reduced entities catch up on the animation they skipped
+                entity->_anim_time += entity->_activity == ENTITY_REDUCED ?
+                    ctx->tick * ACTIVITY_REDUCED_INTERVAL : ctx->tick;
+                entity->_update();
+            }
             alive_entities.push_back(entity);
         }
     }
     
-    game_entities = alive_entities;
+    entities = alive_entities;
     
     // Handle level transition
-    if (game_jump_to_next_level) {
-        game_jump_to_next_level = false;
-        game_map_index++;
+    if (ctx->jump_to_next_level) {
+        ctx->jump_to_next_level = false;
+        ctx->map_index++;
         
-        if (game_map_index == 2) {
+        if (ctx->map_index == 2) {
             title_show_message("THE END", "THANKS FOR PLAYING ❤");
-            if (game_entity_player) {
-                game_entity_player->_dead = true;
+            if (ctx->entity_player) {
+                ctx->entity_player->_dead = true;
             }
             
             // Set camera position for end screen
-            r_camera = vec3(1856, 784, 2272);
-            r_camera_yaw = 0;
-            r_camera_pitch = 0.5f;
+            ctx->camera = vec3(1856, 784, 2272);
+            ctx->camera_yaw = 0;
+            ctx->camera_pitch = 0.5f;
         } else {
-            game_init(game_map_index);
+            game_init(ctx, ctx->map_index);
         }
     }
 }
 
-void game_run(float time_now) {
-    // Calculate delta time
-    game_tick = std::min(time_now - game_real_time_last, 0.05f);
+void game_draw(game_context_t* ctx, float alpha) {
+    // The player overrides this with its interpolated view
+    r_camera = ctx->camera;
+    r_camera_yaw = ctx->camera_yaw;
+    r_camera_pitch = ctx->camera_pitch;
+    
+    for (auto& entity : ctx->entities) {
+        if (!entity->_dead) {
+            entity->_draw(alpha);
+        }
+    }
+    projectile_draw(ctx, alpha);
+}
+
+void game_step(game_context_t* ctx) {
+    ctx->tick = GAME_TICK;
+    ctx->time += ctx->tick;
+    ctx->tick_index++;
+    
+    demo_tick_begin(ctx);
+    game_update(ctx);
+    demo_tick_end(ctx);
+    
+    // Reset input that should only apply once
+    ctx->input->reset_mouse_movement();
+}
+
+void game_run(game_context_t* ctx, float time_now) {
+    // Calculate delta time. Clamp long frames so we don't try to catch up
+    // on seconds of simulation after a stall.
+    game_frame_tick = std::min(time_now - game_real_time_last, GAME_MAX_FRAME_TIME);
     game_real_time_last = time_now;
-    game_time += game_tick;
+    
+    // Run as many fixed simulation ticks as fit into the elapsed time
+    ctx->tick_accumulator += game_frame_tick;
+    while (ctx->tick_accumulator >= GAME_TICK) {
+        ctx->tick_accumulator -= GAME_TICK;
+        game_step(ctx);
+    }
     
     // Clear frame
     r_prepare_frame(0.1f, 0.2f, 0.5f);
     
-    // Update game logic
-    game_update();
+    // Draw entities in between the last two ticks
+    game_draw(ctx, ctx->tick_accumulator / GAME_TICK);
     
     // Draw map
-    map_draw();
+    map_draw(ctx->map);
     
     // Finish rendering
     r_end_frame();
-    
-    // Reset input for next frame
-    g_input->reset_mouse_movement();
 }
 
-void game_cleanup() {
-    game_entities.clear();
-    game_entities_enemies.clear();
-    game_entities_friendly.clear();
-    game_entity_player.reset();
+void game_cleanup(game_context_t* ctx) {
+    ctx->entities.clear();
+    ctx->entities_enemies.clear();
+    ctx->entities_friendly.clear();
+    ctx->entity_player.reset();
 }
\ No newline at end of file
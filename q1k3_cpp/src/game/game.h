@@ -4,34 +4,94 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <cstdint>
 #include "../core/vec3.h"
+#include "../core/random.h"
+#include "timer.h"
+#include "los.h"
+#include "nav.h"
+#include "trigger.h"
+#include "projectile.h"
+#include "demo.h"
+#include "../assets/map.h"
 
 // Forward declarations
 class entity_t;
 class entity_player_t;
+class Input;
+struct map_t;
+struct physics_bodies_t;
 using EntityPtr = std::shared_ptr<entity_t>;
 
-// Global game variables
-extern float game_tick;
-extern float game_time;
-extern float game_real_time_last;
-extern int game_message_timeout;
+// The simulation runs at a fixed rate; rendering interpolates between ticks
+const float GAME_TICK_RATE = 60;
+const float GAME_TICK = 1.0f / GAME_TICK_RATE;
+const float GAME_MAX_FRAME_TIME = 0.25f;
+
+// Everything one running world consists of. Nothing in here is shared, so
+// any number of contexts can be simulated side by side (one thread each);
+// entities keep a pointer to the context they were spawned into.
+struct game_context_t {
+    float tick;
+    float time;
+    float tick_accumulator;     // simulation time not yet stepped
+    uint32_t tick_index;        // ticks stepped since game_reset()
+    
+    std::vector<EntityPtr> entities;
+    std::vector<EntityPtr> entities_enemies;
+    std::vector<EntityPtr> entities_friendly;
+    std::shared_ptr<entity_player_t> entity_player;
+    int map_index;
+    bool jump_to_next_level;
+    
+    const map_t* map;           // current map; the map data itself is shared
+    map_overlay_t overlay;      // doors, on top of the map's collision
+    Timer timers;
+    std::unique_ptr<physics_bodies_t> physics;
+    Input* input;               // read by the player
+    los_cache_t los;            // line of sight to the player
+    nav_field_t nav;            // paths to the player
+    trigger_system_t triggers;  // volumes the player can walk into
+    projectile_system_t projectiles;
+    demo_t demo;                // recording or playback of this world
+    
+    // Last message for the player (pickups, locked doors) and the time it
+    // goes away
+    std::string message;
+    float message_timeout;
+    
+    // Listener position for sounds, set by the player each tick
+    vec3 camera;
+    float camera_yaw;
+    float camera_pitch;
+    
+    // Random numbers of the serial phases (particles, spread...). Entities
+    // have their own streams, seeded from seed_base in spawn order.
+    random_t random;
+    uint32_t seed_base;
+    uint32_t seed_counter;
+    
+    game_context_t(Input* input);
+    ~game_context_t();
+    game_context_t(const game_context_t&) = delete;
+    game_context_t& operator=(const game_context_t&) = delete;
+};
 
-extern std::vector<EntityPtr> game_entities;
-extern std::vector<EntityPtr> game_entities_enemies;
-extern std::vector<EntityPtr> game_entities_friendly;
-extern std::shared_ptr<entity_player_t> game_entity_player;
-extern int game_map_index;
-extern bool game_jump_to_next_level;
+// Frame timing of the window, not part of any world
+extern float game_real_time_last;
+extern float game_frame_tick;       // real time of the last frame
 
 // Game functions
-void game_init(int map_index);
-void game_next_level();
-void game_show_message(const std::string& text);
+void game_init(game_context_t* ctx, int map_index);
+void game_reset(game_context_t* ctx, int map_index, uint32_t seed);
+void game_next_level(game_context_t* ctx);
+void game_show_message(game_context_t* ctx, const std::string& text);
 void title_show_message(const std::string& msg, const std::string& sub = "");
-void game_run(float time_now);
-void game_update();
-void game_cleanup();
+void game_run(game_context_t* ctx, float time_now);
+void game_update(game_context_t* ctx);
+void game_step(game_context_t* ctx);     // one fixed tick: advance time, update, reset input
+void game_draw(game_context_t* ctx, float alpha);
+void game_cleanup(game_context_t* ctx);
 
 // Spawn function is now in entity.h as a template
 
@@ -0,0 +1,144 @@
+#include "hitscan.h"
+#include "entity_light.h"
+#include "../assets/map.h"
+#include <cmath>
+#include <vector>
+
+// Stub for model_explosion - will be loaded from assets
+static model_t* model_explosion = nullptr;
+
+// Cells are 32 x 16 x 32 units
+static const float hitscan_cell[3] = {32, 16, 32};
+
+// Amanatides & Woo grid walk
+float hitscan_trace_map(const game_context_t* ctx, const vec3& from, const vec3& dir,
+                        float range, int* axis) {
+    const float o[3] = {from.x, from.y, from.z};
+    const float d[3] = {dir.x, dir.y, dir.z};
+    int cell[3], step[3];
+    float t_max[3], t_delta[3];
+    
+    for (int a = 0; a < 3; a++) {
+        cell[a] = static_cast<int>(std::floor(o[a] / hitscan_cell[a]));
+        if (d[a] > 0) {
+            step[a] = 1;
+            t_max[a] = ((cell[a] + 1) * hitscan_cell[a] - o[a]) / d[a];
+            t_delta[a] = hitscan_cell[a] / d[a];
+        } else if (d[a] < 0) {
+            step[a] = -1;
+            t_max[a] = (cell[a] * hitscan_cell[a] - o[a]) / d[a];
+            t_delta[a] = -hitscan_cell[a] / d[a];
+        } else {
+            step[a] = 0;
+            t_max[a] = INFINITY;
+            t_delta[a] = INFINITY;
+        }
+    }
+    
+    if (axis) {
+        *axis = 1;
+    }
+    if (map_solid_at(ctx, cell[0], cell[1], cell[2])) {
+        return 0;
+    }
+    
+    while (true) {
+        int a = t_max[0] < t_max[1] ? (t_max[0] < t_max[2] ? 0 : 2) : (t_max[1] < t_max[2] ? 1 : 2);
+        float t = t_max[a];
+        if (t > range) {
+            return t;
+        }
+        cell[a] += step[a];
+        t_max[a] += t_delta[a];
+        if (map_solid_at(ctx, cell[0], cell[1], cell[2])) {
+            if (axis) {
+                *axis = a;
+            }
+            return t;
+        }
+    }
+}
+
+void hitscan_trace(game_context_t* ctx, const hitscan_ray_t* rays, int count,
+                   EntityGroup group, hitscan_hit_t* hits) {
+    const std::vector<EntityPtr>* group_entities =
+        group == ENTITY_GROUP_PLAYER ? &ctx->entities_friendly :
+        group == ENTITY_GROUP_ENEMY ? &ctx->entities_enemies : nullptr;
+    
+    // Broadphase: entities that any of the rays could reach. Projectiles
+    // were 2 units in size, hence the + 2.
+    static thread_local std::vector<std::pair<entity_t*, float>> candidates;
+    candidates.clear();
+    if (group_entities && count) {
+        vec3 from = rays[0].from;
+        float reach = 0;
+        for (int i = 0; i < count; i++) {
+            reach = std::max(reach, vec3_dist(rays[i].from, from) + rays[i].range);
+        }
+        for (auto& entity : *group_entities) {
+            float radius = entity->s.y + 2;
+            if (!entity->_dead && vec3_dist(entity->p, from) < reach + radius) {
+                candidates.push_back({entity.get(), radius});
+            }
+        }
+    }
+    
+    for (int i = 0; i < count; i++) {
+        const hitscan_ray_t& ray = rays[i];
+        hitscan_hit_t& hit = hits[i];
+        hit.target = nullptr;
+        hit.t = hitscan_trace_map(ctx, ray.from, ray.dir, ray.range, nullptr);
+        
+        // Closest entity sphere in front of the wall
+        for (const auto& candidate : candidates) {
+            vec3 m = ray.from - vec3(candidate.first->p);
+            float b = vec3_dot(m, ray.dir);
+            float c = vec3_dot(m, m) - candidate.second * candidate.second;
+            float disc = b * b - c;
+            if ((c > 0 && b > 0) || disc < 0) {
+                continue;
+            }
+            float t = std::max(0.0f, -b - std::sqrt(disc));
+            if (t < hit.t && t <= ray.range) {
+                hit.t = t;
+                hit.target = candidate.first;
+            }
+        }
+        
+        hit.hit = hit.t <= ray.range;
+        hit.pos = ray.from + ray.dir * hit.t;
+    }
+}
+
+void hitscan_fire(game_context_t* ctx, const hitscan_ray_t* rays, int count,
+                  EntityGroup group, EntityPtr from, float damage) {
+    static thread_local std::vector<hitscan_hit_t> hits;
+    hits.resize(count);
+    hitscan_trace(ctx, rays, count, group, hits.data());
+    
+    // Targets may die from an earlier pellet of the same shot
+    for (int i = 0; i < count; i++) {
+        const hitscan_hit_t& hit = hits[i];
+        if (!hit.hit) {
+            continue;
+        }
+        if (hit.target) {
+            if (!hit.target->_dead) {
+                hit.target->_receive_damage(from, damage);
+            }
+            continue;
+        }
+        
+        // Back off from the wall so the effects are in front of it
+        vec3 pos = hit.pos - rays[i].dir * 2.0f;
+        game_spawn_particles(ctx, pos, 2, 80, model_explosion, 4, 0.4f);
+        auto light = game_spawn<entity_light_t>(ctx, pos);
+        if (!light) {
+            continue;
+        }
+        float intensity = 0.5f;
+        int color = 0xff;
+        light->_init(&intensity, &color);
+        light->_die_at = ctx->time + 0.1f;
+    }
+}
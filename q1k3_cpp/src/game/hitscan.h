@@ -0,0 +1,38 @@
+#ifndef HITSCAN_H
+#define HITSCAN_H
+
+#include "../core/vec3.h"
+#include "entity.h"
+
+// Instant hit rays for weapons whose projectiles are too fast to be worth
+// simulating (shotgun pellets: 10000 units/s for 0.1s). All rays of a shot
+// are traced together: the map with a grid DDA (including doors), and
+// entities of one group against a candidate list gathered once per batch.
+struct hitscan_ray_t {
+    vec3 from;
+    vec3 dir;       // normalized
+    float range;
+};
+
+struct hitscan_hit_t {
+    bool hit;       // false: nothing within range
+    vec3 pos;
+    float t;        // distance along the ray
+    entity_t* target;   // nullptr for the map
+};
+
+// Distance along dir to the first solid map cell (doors included), or a
+// value > range if there is none. axis is set to the axis of the face that
+// was hit (0 = x, 1 = y, 2 = z).
+float hitscan_trace_map(const game_context_t* ctx, const vec3& from, const vec3& dir,
+                        float range, int* axis);
+
+void hitscan_trace(game_context_t* ctx, const hitscan_ray_t* rays, int count,
+                   EntityGroup group, hitscan_hit_t* hits);
+
+// Trace and apply: damage to entities hit, impact particles and a flash
+// where the map was hit
+void hitscan_fire(game_context_t* ctx, const hitscan_ray_t* rays, int count,
+                  EntityGroup group, EntityPtr from, float damage);
+
+#endif // HITSCAN_H
@@ -0,0 +1,66 @@
+#include "los.h"
+#include "entity.h"
+#include "entity_player.h"
+#include "activity.h"
+#include "../assets/map.h"
+
+static uint32_t los_cell(const vec3& pos) {
+    uint32_t x = static_cast<uint32_t>(static_cast<int>(pos.x) >> 5) & 127;
+    uint32_t y = static_cast<uint32_t>(static_cast<int>(pos.y) >> 4) & 127;
+    uint32_t z = static_cast<uint32_t>(static_cast<int>(pos.z) >> 5) & 127;
+    return x | (y << 7) | (z << 14);
+}
+
+void los_update(game_context_t* ctx) {
+    los_cache_t& los = ctx->los;
+    if (!ctx->entity_player || ctx->entity_player->_dead) {
+        return;
+    }
+    
+    vec3 player_pos = ctx->entity_player->p;
+    uint32_t player_cell = los_cell(player_pos);
+    if (player_cell != los.player_cell || ctx->map != los.map) {
+        los.visible.clear();
+        los.player_cell = player_cell;
+        los.map = ctx->map;
+    }
+    
+    // Collect the cells we don't know about yet, once each. They go into
+    // the cache right away (filled in after the batch), so a cell already
+    // queued is a hit like a known one.
+    los.pending_cells.clear();
+    los.pending_from.clear();
+    los.pending_to.clear();
+    for (auto& entity : ctx->entities) {
+        if (entity->_dead || !activity_due(entity.get(), ctx->tick_index) || !entity->_needs_los()) {
+            continue;
+        }
+        uint32_t cell = los_cell(entity->p);
+        if (!los.visible.emplace(cell, false).second) {
+            continue;
+        }
+        los.pending_cells.push_back(cell);
+        los.pending_from.push_back(entity->p);
+        los.pending_to.push_back(player_pos);
+    }
+    
+    int count = static_cast<int>(los.pending_cells.size());
+    if (!count) {
+        return;
+    }
+    
+    los.pending_blocked.resize(count);
+    map_trace_batch(ctx->map, los.pending_from.data(), los.pending_to.data(),
+                    count, los.pending_blocked.data());
+    for (int i = 0; i < count; i++) {
+        los.visible[los.pending_cells[i]] = !los.pending_blocked[i];
+    }
+}
+
+bool los_player_visible(const game_context_t* ctx, const vec3& pos) {
+    auto it = ctx->los.visible.find(los_cell(pos));
+    if (it != ctx->los.visible.end() && ctx->los.map == ctx->map) {
+        return it->second;
+    }
+    return !map_trace(ctx->map, pos, ctx->entity_player->p);
+}
@@ -0,0 +1,34 @@
+#ifndef LOS_H
+#define LOS_H
+
+#include "../core/vec3.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct game_context_t;
+
+// Line of sight from entities to the player, shared by everyone standing in
+// the same map cell. los_update() collects the queries of all entities that
+// will _think() this tick (_needs_los()), drops the ones already known and
+// traces the rest in one batch. Results stay valid until the player moves
+// to another cell. During the parallel think phase the cache is only read.
+struct los_cache_t {
+    uint32_t player_cell = UINT32_MAX;
+    const void* map = nullptr;
+    std::unordered_map<uint32_t, bool> visible;   // by cell of the observer
+    
+    // Scratch space for the batch, kept to avoid allocations
+    std::vector<uint32_t> pending_cells;
+    std::vector<vec3> pending_from;
+    std::vector<vec3> pending_to;
+    std::vector<uint8_t> pending_blocked;  // map_trace_batch() results
+};
+
+void los_update(game_context_t* ctx);
+
+// Whether the player can be seen from pos. Answered from the cache; a miss
+// (an entity that didn't ask in los_update()) falls back to map_trace().
+bool los_player_visible(const game_context_t* ctx, const vec3& pos);
+
+#endif // LOS_H
@@ -0,0 +1,148 @@
+#include "nav.h"
+#include "entity.h"
+#include "entity_player.h"
+#include "../assets/map.h"
+#include <cstdlib>
+
+static const int NAV_SIZE = 128;   // map size in cells
+
+std::shared_ptr<nav_graph_t> nav_build(const map_t* map) {
+    auto graph = std::make_shared<nav_graph_t>();
+    graph->column_start.resize(NAV_SIZE * NAV_SIZE + 1);
+    
+    for (int z = 0; z < NAV_SIZE; z++) {
+        for (int x = 0; x < NAV_SIZE; x++) {
+            graph->column_start[z * NAV_SIZE + x] = static_cast<uint32_t>(graph->node_y.size());
+            
+            // Count free cells from the top down, so the headroom check is
+            // a single comparison
+            int free_above = 0;
+            for (int y = NAV_SIZE - 1; y > 0; y--) {
+                if (map_block_at(map, x, y, z)) {
+                    free_above = 0;
+                    continue;
+                }
+                free_above++;
+                if (free_above >= NAV_HEADROOM && map_block_at(map, x, y - 1, z)) {
+                    graph->node_y.push_back(static_cast<uint8_t>(y));
+                    graph->node_column.push_back(static_cast<uint16_t>(z * NAV_SIZE + x));
+                }
+            }
+        }
+    }
+    graph->column_start[NAV_SIZE * NAV_SIZE] = static_cast<uint32_t>(graph->node_y.size());
+    return graph;
+}
+
+// Node in column (x, z) with its floor closest to feet_y, at most a step away
+static int nav_node_at(const nav_graph_t* graph, int x, int z, int feet_y) {
+    if (x < 0 || z < 0 || x >= NAV_SIZE || z >= NAV_SIZE) {
+        return -1;
+    }
+    int column = z * NAV_SIZE + x;
+    int best = -1;
+    int best_dy = NAV_MAX_STEP + 1;
+    for (uint32_t n = graph->column_start[column]; n < graph->column_start[column + 1]; n++) {
+        int dy = std::abs(graph->node_y[n] - feet_y);
+        if (dy < best_dy) {
+            best = static_cast<int>(n);
+            best_dy = dy;
+        }
+    }
+    return best;
+}
+
+static int nav_node_for(const nav_graph_t* graph, const vec3& pos, float size_y) {
+    return nav_node_at(graph, static_cast<int>(pos.x) >> 5, static_cast<int>(pos.z) >> 5,
+                       static_cast<int>(pos.y - size_y) >> 4);
+}
+
+// Doors and other movers close off nodes they overlap
+static bool nav_node_blocked(const map_overlay_t* overlay, int x, int y, int z) {
+    for (int i = 0; i < NAV_HEADROOM; i++) {
+        if (map_overlay_at(overlay, x, y + i, z)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static const int nav_dx[4] = {1, -1, 0, 0};
+static const int nav_dz[4] = {0, 0, 1, -1};
+
+void nav_update(game_context_t* ctx) {
+    nav_field_t& field = ctx->nav;
+    const nav_graph_t* graph = map_nav(ctx->map);
+    if (!graph || !ctx->entity_player || ctx->entity_player->_dead) {
+        return;
+    }
+    
+    int goal = nav_node_for(graph, ctx->entity_player->p, ctx->entity_player->s.y);
+    if (goal < 0 || (goal == field.goal && graph == field.graph &&
+                     ctx->overlay.version == field.overlay_version)) {
+        return;
+    }
+    field.goal = goal;
+    field.graph = graph;
+    field.overlay_version = ctx->overlay.version;
+    
+    // Breadth first search outwards from the player
+    field.dist.assign(graph->node_y.size(), NAV_UNREACHABLE);
+    field.queue.clear();
+    field.queue.push_back(goal);
+    field.dist[goal] = 0;
+    
+    for (size_t head = 0; head < field.queue.size(); head++) {
+        int node = field.queue[head];
+        
+        int column = graph->node_column[node];
+        int x = column % NAV_SIZE;
+        int z = column / NAV_SIZE;
+        int y = graph->node_y[node];
+        uint16_t next_dist = field.dist[node] + 1;
+        
+        for (int d = 0; d < 4; d++) {
+            int nx = x + nav_dx[d];
+            int nz = z + nav_dz[d];
+            int next = nav_node_at(graph, nx, nz, y);
+            if (next >= 0 && field.dist[next] == NAV_UNREACHABLE &&
+                !nav_node_blocked(&ctx->overlay, nx, graph->node_y[next], nz)) {
+                field.dist[next] = next_dist;
+                field.queue.push_back(next);
+            }
+        }
+    }
+}
+
+bool nav_yaw_to_player(const game_context_t* ctx, const vec3& pos, float size_y, float* yaw) {
+    const nav_field_t& field = ctx->nav;
+    if (!field.graph || field.graph != map_nav(ctx->map)) {
+        return false;
+    }
+    
+    int node = nav_node_for(field.graph, pos, size_y);
+    if (node < 0 || field.dist[node] == NAV_UNREACHABLE) {
+        return false;
+    }
+    
+    int x = static_cast<int>(pos.x) >> 5;
+    int z = static_cast<int>(pos.z) >> 5;
+    int y = field.graph->node_y[node];
+    int best = -1;
+    uint16_t best_dist = field.dist[node];
+    for (int d = 0; d < 4; d++) {
+        int next = nav_node_at(field.graph, x + nav_dx[d], z + nav_dz[d], y);
+        if (next >= 0 && field.dist[next] < best_dist) {
+            best = d;
+            best_dist = field.dist[next];
+        }
+    }
+    if (best < 0) {
+        return false;
+    }
+    
+    // Head for the center of the next cell
+    vec3 target(((x + nav_dx[best]) << 5) + 16, pos.y, ((z + nav_dz[best]) << 5) + 16);
+    *yaw = vec3_2d_angle(pos, target);
+    return true;
+}
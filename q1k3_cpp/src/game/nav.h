@@ -0,0 +1,47 @@
+#ifndef NAV_H
+#define NAV_H
+
+#include "../core/vec3.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct map_t;
+struct game_context_t;
+
+// Walkable floor of a map, derived from its collision map once at load
+// time. A node is a free cell with a solid block below and NAV_HEADROOM free
+// cells above; a column (x, z) can have several nodes on different floors.
+// Nodes of neighbouring columns are connected if their floors are at most
+// NAV_MAX_STEP cells apart (the enemies' step height is 17 units).
+const int NAV_HEADROOM = 4;     // 64 units, the tallest enemy is 56
+const int NAV_MAX_STEP = 1;
+const uint16_t NAV_UNREACHABLE = 0xffff;
+
+struct nav_graph_t {
+    std::vector<uint32_t> column_start;  // nodes of column c: [c], [c + 1]
+    std::vector<uint8_t> node_y;
+    std::vector<uint16_t> node_column;
+};
+
+std::shared_ptr<nav_graph_t> nav_build(const map_t* map);
+
+// Distance (in nodes) of every node to the player. Shared by all enemies of
+// a world and only recomputed when the player reaches another node or a
+// door opens or closes (the overlay changes).
+struct nav_field_t {
+    const nav_graph_t* graph = nullptr;
+    int goal = -1;
+    uint32_t overlay_version = 0;
+    std::vector<uint16_t> dist;
+    std::vector<int> queue;   // BFS scratch, kept to avoid allocations
+};
+
+void nav_update(game_context_t* ctx);
+
+// Yaw towards the neighbouring node closest to the player, for an entity
+// standing at pos with half height size_y. Returns false if pos is not on
+// the graph or the player can't be reached from there.
+bool nav_yaw_to_player(const game_context_t* ctx, const vec3& pos, float size_y, float* yaw);
+
+#endif // NAV_H
@@ -0,0 +1,121 @@
+#include "physics.h"
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+static void physics_body_reset(physics_bodies_t& pb, int b) {
+    pb.px[b] = pb.py[b] = pb.pz[b] = 0;
+    pb.ppx[b] = pb.ppy[b] = pb.ppz[b] = 0;
+    pb.vx[b] = pb.vy[b] = pb.vz[b] = 0;
+    pb.ax[b] = pb.ay[b] = pb.az[b] = 0;
+    pb.f[b] = 0;
+    pb.gravity[b] = 0;
+    pb.bounciness[b] = 0;
+}
+
+bool physics_body_available(physics_bodies_t& pb) {
+    if (!pb.free_bodies.empty() || pb.count < PHYSICS_MAX_BODIES) {
+        return true;
+    }
+    if (!pb.warned_full) {
+        std::cerr << "Out of physics bodies (" << PHYSICS_MAX_BODIES << ")" << std::endl;
+        pb.warned_full = true;
+    }
+    return false;
+}
+
+int physics_body_alloc(physics_bodies_t& pb, const vec3& pos) {
+    int b;
+    if (!pb.free_bodies.empty()) {
+        b = pb.free_bodies.back();
+        pb.free_bodies.pop_back();
+    } else {
+        b = pb.count++;
+    }
+
+    physics_body_reset(pb, b);
+    physics_body_p(pb, b) = pos;
+    pb.ppx[b] = pos.x;
+    pb.ppy[b] = pos.y;
+    pb.ppz[b] = pos.z;
+    pb.gravity[b] = 1;
+    return b;
+}
+
+void physics_body_free(physics_bodies_t& pb, int body) {
+    if (body < 0 || body >= PHYSICS_MAX_BODIES) return;
+
+    // Freed slots are zeroed (incl. gravity) so the integrator can keep
+    // running over them without producing anything but zeros.
+    physics_body_reset(pb, body);
+    pb.free_bodies.push_back(body);
+}
+
+int physics_num_bodies(const physics_bodies_t& pb) {
+    return pb.count - static_cast<int>(pb.free_bodies.size());
+}
+
+void physics_integrate(physics_bodies_t& pb, float dt) {
+    int n = pb.count;
+    int i = 0;
+
+    // Same operation order as the scalar loop below, so results are identical
+    // regardless of which path is compiled in:
+    // a.y = -1200 * gravity; v = v + (a * dt - v * (ff, 0, ff))
+#if defined(__AVX__)
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 vone = _mm256_set1_ps(1.0f);
+    const __m256 vgrav = _mm256_set1_ps(-1200.0f);
+    for (; i + 8 <= n; i += 8) {
+        __m256 ay = _mm256_mul_ps(vgrav, _mm256_load_ps(pb.gravity + i));
+        __m256 ff = _mm256_min_ps(_mm256_mul_ps(_mm256_load_ps(pb.f + i), vdt), vone);
+        __m256 vx = _mm256_load_ps(pb.vx + i);
+        __m256 vz = _mm256_load_ps(pb.vz + i);
+        __m256 dx = _mm256_sub_ps(_mm256_mul_ps(_mm256_load_ps(pb.ax + i), vdt), _mm256_mul_ps(vx, ff));
+        __m256 dz = _mm256_sub_ps(_mm256_mul_ps(_mm256_load_ps(pb.az + i), vdt), _mm256_mul_ps(vz, ff));
+        _mm256_store_ps(pb.ay + i, ay);
+        _mm256_store_ps(pb.vx + i, _mm256_add_ps(vx, dx));
+        _mm256_store_ps(pb.vy + i, _mm256_add_ps(_mm256_load_ps(pb.vy + i), _mm256_mul_ps(ay, vdt)));
+        _mm256_store_ps(pb.vz + i, _mm256_add_ps(vz, dz));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 vone = _mm_set1_ps(1.0f);
+    const __m128 vgrav = _mm_set1_ps(-1200.0f);
+    for (; i + 4 <= n; i += 4) {
+        __m128 ay = _mm_mul_ps(vgrav, _mm_load_ps(pb.gravity + i));
+        __m128 ff = _mm_min_ps(_mm_mul_ps(_mm_load_ps(pb.f + i), vdt), vone);
+        __m128 vx = _mm_load_ps(pb.vx + i);
+        __m128 vz = _mm_load_ps(pb.vz + i);
+        __m128 dx = _mm_sub_ps(_mm_mul_ps(_mm_load_ps(pb.ax + i), vdt), _mm_mul_ps(vx, ff));
+        __m128 dz = _mm_sub_ps(_mm_mul_ps(_mm_load_ps(pb.az + i), vdt), _mm_mul_ps(vz, ff));
+        _mm_store_ps(pb.ay + i, ay);
+        _mm_store_ps(pb.vx + i, _mm_add_ps(vx, dx));
+        _mm_store_ps(pb.vy + i, _mm_add_ps(_mm_load_ps(pb.vy + i), _mm_mul_ps(ay, vdt)));
+        _mm_store_ps(pb.vz + i, _mm_add_ps(vz, dz));
+    }
+#endif
+
+    for (; i < n; i++) {
+        float ay = -1200 * pb.gravity[i];
+        float ff = std::min(pb.f[i] * dt, 1.0f);
+        pb.ay[i] = ay;
+        pb.vx[i] = pb.vx[i] + (pb.ax[i] * dt - pb.vx[i] * ff);
+        pb.vy[i] = pb.vy[i] + ay * dt;
+        pb.vz[i] = pb.vz[i] + (pb.az[i] * dt - pb.vz[i] * ff);
+    }
+}
+
+void physics_snapshot(physics_bodies_t& pb) {
+    size_t size = pb.count * sizeof(float);
+    std::memcpy(pb.ppx, pb.px, size);
+    std::memcpy(pb.ppy, pb.py, size);
+    std::memcpy(pb.ppz, pb.pz, size);
+}
@@ -0,0 +1,72 @@
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include "../core/vec3.h"
+#include <vector>
+
+// Kinematic state of all physics bodies, stored as structure-of-arrays so
+// gravity, friction and velocity can be integrated for 8 bodies at a time.
+// Entities keep a handle (index) into these arrays; collisions are resolved
+// per entity in a second pass (entity_t::_update_physics). Each game context
+// owns one physics_bodies_t.
+// Entities hold references into the arrays, so they can't grow; when all
+// bodies are in use, spawning fails (game_spawn returns null).
+const int PHYSICS_MAX_BODIES = 1024 * 16;
+
+struct physics_bodies_t {
+    alignas(32) float px[PHYSICS_MAX_BODIES];
+    alignas(32) float py[PHYSICS_MAX_BODIES];
+    alignas(32) float pz[PHYSICS_MAX_BODIES];
+    alignas(32) float vx[PHYSICS_MAX_BODIES];
+    alignas(32) float vy[PHYSICS_MAX_BODIES];
+    alignas(32) float vz[PHYSICS_MAX_BODIES];
+    alignas(32) float ax[PHYSICS_MAX_BODIES];
+    alignas(32) float ay[PHYSICS_MAX_BODIES];
+    alignas(32) float az[PHYSICS_MAX_BODIES];
+    alignas(32) float f[PHYSICS_MAX_BODIES];          // friction
+    alignas(32) float gravity[PHYSICS_MAX_BODIES];
+    alignas(32) float bounciness[PHYSICS_MAX_BODIES];
+    
+    // Positions at the last physics_snapshot()
+    alignas(32) float ppx[PHYSICS_MAX_BODIES];
+    alignas(32) float ppy[PHYSICS_MAX_BODIES];
+    alignas(32) float ppz[PHYSICS_MAX_BODIES];
+    
+    // Bodies are handed out from the free list first, then from the high
+    // water mark
+    std::vector<int> free_bodies;
+    int count = 0;
+    bool warned_full = false;
+};
+
+// Body allocation. physics_body_available() is false, with a warning the
+// first time, once all bodies are in use; only allocate if it is true.
+bool physics_body_available(physics_bodies_t& pb);
+int physics_body_alloc(physics_bodies_t& pb, const vec3& pos);
+void physics_body_free(physics_bodies_t& pb, int body);
+int physics_num_bodies(const physics_bodies_t& pb);
+
+// Views into a body's state
+inline vec3_ref physics_body_p(physics_bodies_t& pb, int b) {
+    return vec3_ref(pb.px[b], pb.py[b], pb.pz[b]);
+}
+inline vec3_ref physics_body_v(physics_bodies_t& pb, int b) {
+    return vec3_ref(pb.vx[b], pb.vy[b], pb.vz[b]);
+}
+inline vec3_ref physics_body_a(physics_bodies_t& pb, int b) {
+    return vec3_ref(pb.ax[b], pb.ay[b], pb.az[b]);
+}
+inline vec3 physics_body_prev_p(const physics_bodies_t& pb, int b) {
+    return vec3(pb.ppx[b], pb.ppy[b], pb.ppz[b]);
+}
+
+// Apply gravity and integrate acceleration & friction into velocity for
+// all bodies (first pass). Positions are not touched here.
+void physics_integrate(physics_bodies_t& pb, float dt);
+
+// Remember the current position of all bodies. Entities moving in parallel
+// test against each other at these positions, so the outcome doesn't depend
+// on the order in which threads get to them.
+void physics_snapshot(physics_bodies_t& pb);
+
+#endif // PHYSICS_H
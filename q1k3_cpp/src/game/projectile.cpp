@@ -0,0 +1,344 @@
+#include "projectile.h"
+#include "entity.h"
+#include "entity_light.h"
+#include "hitscan.h"
+#include "../renderer/renderer.h"
+#include <algorithm>
+#include <cmath>
+
+// Stubs - will be loaded from assets
+static model_t* model_explosion = nullptr;
+static model_t* model_nail = nullptr;
+static model_t* model_grenade = nullptr;
+static model_t* model_plasma = nullptr;
+static model_t* model_gib = nullptr;
+
+// Impact handlers return false when the projectile is gone
+typedef bool (*projectile_hit_map_t)(game_context_t* ctx, projectile_t& pr, int axis, const vec3& impact_v);
+typedef bool (*projectile_hit_entity_t)(game_context_t* ctx, projectile_t& pr, entity_t* other);
+
+struct projectile_type_info_t {
+    model_t** model;
+    int texture;
+    float radius;
+    float gravity;
+    float bounciness;
+    float friction;
+    float lifetime;
+    float fuse;         // time until on_fuse(), 0 for none
+    float damage;       // to entities hit
+    int num_frames;     // animation: frames 0 .. num_frames-1, frame_time each
+    float frame_time;
+    float light;        // intensity of a light following it, 0 for none
+    vec3 light_color;
+    projectile_hit_map_t hit_map;
+    projectile_hit_entity_t hit_entity;
+    void (*on_fuse)(game_context_t* ctx, projectile_t& pr);
+};
+
+static void projectile_flash(game_context_t* ctx, const vec3& pos, float intensity, int color, float duration) {
+    auto light = game_spawn<entity_light_t>(ctx, pos, &intensity, &color);
+    if (light) {
+        light->_die_at = ctx->time + duration;
+    }
+}
+
+static bool projectile_nail_hit_map(game_context_t* ctx, projectile_t& pr, int /*axis*/, const vec3& /*impact_v*/) {
+    game_spawn_particles(ctx, pr.p, 3, 200, model_explosion, 4, 0.3f);
+    return false;
+}
+
+static bool projectile_plasma_hit_map(game_context_t* ctx, projectile_t& pr, int /*axis*/, const vec3& /*impact_v*/) {
+    game_spawn_particles(ctx, pr.p, 3, 200, model_explosion, 22, 0.3f);
+    return false;
+}
+
+static bool projectile_damage(game_context_t* /*ctx*/, projectile_t& pr, entity_t* other, float amount) {
+    other->_receive_damage(pr.owner, amount);
+    return false;
+}
+
+static bool projectile_nail_hit_entity(game_context_t* ctx, projectile_t& pr, entity_t* other) {
+    return projectile_damage(ctx, pr, other, 15);
+}
+
+static bool projectile_plasma_hit_entity(game_context_t* ctx, projectile_t& pr, entity_t* other) {
+    return projectile_damage(ctx, pr, other, 20);
+}
+
+static void projectile_grenade_explode(game_context_t* ctx, projectile_t& pr) {
+    game_spawn_particles(ctx, pr.p, 32, 300, model_explosion, 4, 0.5f);
+    activity_noise(ctx, pr.p, ACTIVITY_DORMANT_DIST);
+    
+    // Damage nearby entities. Damage can spawn entities, so no iterators.
+    for (size_t i = 0; i < ctx->entities.size(); i++) {
+        EntityPtr entity = ctx->entities[i];
+        float dist = vec3_dist(entity->p, pr.p);
+        if (dist < 128) {
+            entity->_receive_damage(pr.owner, (128 - dist) / 5);
+        }
+    }
+    
+    projectile_flash(ctx, pr.p, 100.0f, 0xffa020, 0.5f);
+    pr.die_at = 0;
+}
+
+static bool projectile_grenade_hit_map(game_context_t* ctx, projectile_t& pr, int axis, const vec3& impact_v) {
+    if (axis == 1 && impact_v.y < -100) {
+        projectile_grenade_explode(ctx, pr);
+        return false;
+    }
+    return true;
+}
+
+static bool projectile_grenade_hit_entity(game_context_t* ctx, projectile_t& pr, entity_t* /*other*/) {
+    projectile_grenade_explode(ctx, pr);
+    return false;
+}
+
+static bool projectile_gib_hit_map(game_context_t* /*ctx*/, projectile_t& pr, int /*axis*/, const vec3& /*impact_v*/) {
+    pr.v = pr.v * 0.8f;
+    return true;
+}
+
+static bool projectile_gib_hit_entity(game_context_t* ctx, projectile_t& pr, entity_t* other) {
+    return projectile_damage(ctx, pr, other, 10);
+}
+
+static const projectile_type_info_t projectile_types[PROJECTILE_NUM_TYPES] = {
+    // model           tex rad grav bounce fric life fuse  dmg  anim        light
+    {&model_nail,      8,  2,  0,   0,     0,   3,   0,    15,  1, 0,       0, vec3(0, 0, 0),
+     projectile_nail_hit_map, projectile_nail_hit_entity, nullptr},
+    {&model_grenade,   21, 2,  1,   0.5f,  5,   4,   1.5f, 0,   1, 0,       0, vec3(0, 0, 0),
+     projectile_grenade_hit_map, projectile_grenade_hit_entity, projectile_grenade_explode},
+    {&model_plasma,    29, 4,  0,   0,     0,   2,   0,    20,  4, 0.1f,    0.5f, vec3(1, 0.7f, 0.7f),
+     projectile_plasma_hit_map, projectile_plasma_hit_entity, nullptr},
+    {&model_gib,       11, 2,  1,   0.5f,  12,  5,   0,    10,  1, 0,       0, vec3(0, 0, 0),
+     projectile_gib_hit_map, projectile_gib_hit_entity, nullptr},
+};
+
+// Entities of one group that any projectile of a pool could reach this tick
+struct projectile_candidates_t {
+    vec3 min, max;
+    bool any = false;
+    std::vector<entity_t*> entities;
+};
+
+void projectile_clear(game_context_t* ctx) {
+    for (auto& pool : ctx->projectiles.pools) {
+        pool.clear();
+    }
+}
+
+void projectile_spawn(game_context_t* ctx, projectile_type_t type, const vec3& pos,
+                      const vec3& v, float yaw, float pitch, int check_against,
+                      std::shared_ptr<entity_t> owner) {
+    const projectile_type_info_t& info = projectile_types[type];
+    projectile_t pr;
+    pr.p = pos;
+    pr.prev_p = pos;
+    pr.v = v;
+    pr.yaw = yaw;
+    pr.pitch = pitch;
+    pr.die_at = ctx->time + info.lifetime;
+    pr.explode_at = info.fuse ? ctx->time + info.fuse : 0;
+    pr.check_against = static_cast<uint8_t>(check_against);
+    pr.on_ground = false;
+    pr.owner = std::move(owner);
+    ctx->projectiles.pools[type].push_back(std::move(pr));
+}
+
+static void projectile_gather(projectile_candidates_t& candidates,
+                              const std::vector<EntityPtr>& group, float radius) {
+    candidates.entities.clear();
+    if (!candidates.any) {
+        return;
+    }
+    for (auto& entity : group) {
+        float r = entity->s.y + radius;
+        vec3 ep = entity->p;
+        if (!entity->_dead &&
+            ep.x + r >= candidates.min.x && ep.x - r <= candidates.max.x &&
+            ep.y + r >= candidates.min.y && ep.y - r <= candidates.max.y &&
+            ep.z + r >= candidates.min.z && ep.z - r <= candidates.max.z) {
+            candidates.entities.push_back(entity.get());
+        }
+    }
+}
+
+// Closest entity whose sphere the segment from + dir * [0, range] touches
+static entity_t* projectile_sweep_entities(const std::vector<entity_t*>& entities, const vec3& from,
+                                           const vec3& dir, float range, float radius, float* t_hit) {
+    entity_t* hit = nullptr;
+    for (entity_t* entity : entities) {
+        if (entity->_dead) {
+            continue;
+        }
+        float r = entity->s.y + radius;
+        vec3 m = from - vec3(entity->p);
+        float b = vec3_dot(m, dir);
+        float c = vec3_dot(m, m) - r * r;
+        float disc = b * b - c;
+        if ((c > 0 && b > 0) || disc < 0) {
+            continue;
+        }
+        float t = std::max(0.0f, -b - std::sqrt(disc));
+        if (t <= range && t < *t_hit) {
+            *t_hit = t;
+            hit = entity;
+        }
+    }
+    return hit;
+}
+
+// Moves one projectile through the tick; false when it is gone. A bounce
+// uses up the part of the move up to the wall, the rest continues with the
+// reflected velocity (at most once per axis).
+static bool projectile_move(game_context_t* ctx, const projectile_type_info_t& info, projectile_t& pr,
+                            const std::vector<entity_t*>& candidates) {
+    float remaining = ctx->tick;
+    for (int bounce = 0; bounce < 3 && remaining > 0; bounce++) {
+        vec3 move = pr.v * remaining;
+        float len = vec3_length(move);
+        if (len <= 0) {
+            break;
+        }
+        vec3 dir = move * (1.0f / len);
+        
+        int axis;
+        float t_map = hitscan_trace_map(ctx, pr.p, dir, len, &axis);
+        float t_entity = std::min(t_map, len);
+        entity_t* other = projectile_sweep_entities(candidates, pr.p, dir, len, info.radius, &t_entity);
+        
+        if (other) {
+            pr.p = pr.p + dir * t_entity;
+            if (!info.hit_entity(ctx, pr, other)) {
+                return false;
+            }
+            break;
+        }
+        
+        if (t_map > len) {
+            pr.p = pr.p + move;
+            break;
+        }
+        
+        // Stop just in front of the wall and bounce off the face that was hit
+        pr.p = pr.p + dir * std::max(0.0f, t_map - 0.01f);
+        vec3 impact_v = pr.v;
+        if (axis == 1) {
+            float bounciness = std::abs(pr.v.y) > 200 ? info.bounciness : 0;
+            pr.on_ground = pr.v.y < 0 && !bounciness;
+            pr.v.y = -pr.v.y * bounciness;
+        } else if (axis == 0) {
+            pr.v.x = -pr.v.x * info.bounciness;
+        } else {
+            pr.v.z = -pr.v.z * info.bounciness;
+        }
+        if (!info.hit_map(ctx, pr, axis, impact_v)) {
+            return false;
+        }
+        remaining *= 1 - t_map / len;
+    }
+    return true;
+}
+
+void projectile_update(game_context_t* ctx) {
+    float dt = ctx->tick;
+    const std::vector<EntityPtr>* groups[2] = {&ctx->entities_friendly, &ctx->entities_enemies};
+    static thread_local projectile_candidates_t candidates[2];
+    static const std::vector<entity_t*> no_candidates;
+    
+    for (int type = 0; type < PROJECTILE_NUM_TYPES; type++) {
+        const projectile_type_info_t& info = projectile_types[type];
+        std::vector<projectile_t>& pool = ctx->projectiles.pools[type];
+        if (pool.empty()) {
+            continue;
+        }
+        
+        // Integrate velocity (same as physics_integrate()) and find the
+        // bounds of everything the pool sweeps through this tick
+        float ff = std::min(info.friction * dt, 1.0f);
+        for (auto& c : candidates) {
+            c.any = false;
+        }
+        for (auto& pr : pool) {
+            pr.prev_p = pr.p;
+            pr.v.x -= pr.v.x * ff;
+            pr.v.y += -1200 * info.gravity * dt;
+            pr.v.z -= pr.v.z * ff;
+            
+            int g = pr.check_against - ENTITY_GROUP_PLAYER;
+            if (g < 0 || g > 1) {
+                continue;
+            }
+            projectile_candidates_t& c = candidates[g];
+            vec3 to = pr.p + pr.v * dt;
+            vec3 lo(std::min(pr.p.x, to.x), std::min(pr.p.y, to.y), std::min(pr.p.z, to.z));
+            vec3 hi(std::max(pr.p.x, to.x), std::max(pr.p.y, to.y), std::max(pr.p.z, to.z));
+            if (!c.any) {
+                c.min = lo;
+                c.max = hi;
+                c.any = true;
+            } else {
+                c.min = vec3(std::min(c.min.x, lo.x), std::min(c.min.y, lo.y), std::min(c.min.z, lo.z));
+                c.max = vec3(std::max(c.max.x, hi.x), std::max(c.max.y, hi.y), std::max(c.max.z, hi.z));
+            }
+        }
+        for (int g = 0; g < 2; g++) {
+            projectile_gather(candidates[g], *groups[g], info.radius);
+        }
+        
+        // Handlers may damage entities, which may spawn more projectiles;
+        // those start moving next tick
+        size_t count = pool.size();
+        for (size_t i = 0; i < count; i++) {
+            projectile_t pr = std::move(pool[i]);
+            bool alive = pr.die_at >= ctx->time;
+            if (alive) {
+                int g = pr.check_against - ENTITY_GROUP_PLAYER;
+                alive = projectile_move(ctx, info, pr, g == 0 || g == 1 ? candidates[g].entities : no_candidates);
+            }
+            if (alive && pr.explode_at && ctx->time > pr.explode_at) {
+                info.on_fuse(ctx, pr);
+                alive = false;
+            }
+            if (!alive) {
+                pr.die_at = 0;
+            }
+            pool[i] = std::move(pr);
+        }
+        
+        // Compact, keeping the order
+        pool.erase(std::remove_if(pool.begin(), pool.end(), [](const projectile_t& pr) {
+            return pr.die_at == 0;
+        }), pool.end());
+    }
+}
+
+void projectile_draw(game_context_t* ctx, float alpha) {
+    for (int type = 0; type < PROJECTILE_NUM_TYPES; type++) {
+        const projectile_type_info_t& info = projectile_types[type];
+        model_t* model = *info.model;
+        int frame = info.num_frames > 1 ?
+            static_cast<int>(ctx->time / info.frame_time) % info.num_frames : 0;
+        for (const auto& pr : ctx->projectiles.pools[type]) {
+            vec3 pos = pr.prev_p + (pr.p - pr.prev_p) * alpha;
+            if (model) {
+                r_draw_model(pos, pr.yaw, pr.pitch, info.texture,
+                             model, frame, frame, 0);
+            }
+            if (info.light) {
+                r_push_light(pos, info.light, info.light_color.x, info.light_color.y, info.light_color.z);
+            }
+        }
+    }
+}
+
+int projectile_count(const game_context_t* ctx) {
+    int count = 0;
+    for (const auto& pool : ctx->projectiles.pools) {
+        count += static_cast<int>(pool.size());
+    }
+    return count;
+}
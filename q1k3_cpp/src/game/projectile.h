@@ -0,0 +1,57 @@
+#ifndef PROJECTILE_H
+#define PROJECTILE_H
+
+#include "../core/vec3.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct game_context_t;
+struct model_t;
+class entity_t;
+
+// Nails, grenades, plasma and gibs. They are not entities: each type has its
+// own contiguous pool, all of a type are moved in one pass with a swept ray
+// against the map grid and the entities gathered once for the whole pool,
+// and what happens on impact comes from the type's row in a table.
+enum projectile_type_t {
+    PROJECTILE_NAIL = 0,
+    PROJECTILE_GRENADE,
+    PROJECTILE_PLASMA,
+    PROJECTILE_GIB,
+    PROJECTILE_NUM_TYPES
+};
+
+struct projectile_t {
+    vec3 p;
+    vec3 prev_p;        // at the start of the tick, for drawing
+    vec3 v;
+    float yaw;
+    float pitch;
+    float die_at;
+    float explode_at;   // 0: no fuse
+    uint8_t check_against;  // EntityGroup of the entities it hits
+    bool on_ground;
+    std::shared_ptr<entity_t> owner;    // who fired it, for _receive_damage()
+};
+
+struct projectile_system_t {
+    std::vector<projectile_t> pools[PROJECTILE_NUM_TYPES];
+};
+
+void projectile_clear(game_context_t* ctx);
+
+// Fires a projectile at pos with velocity v. check_against is an EntityGroup.
+void projectile_spawn(game_context_t* ctx, projectile_type_t type, const vec3& pos,
+                      const vec3& v, float yaw, float pitch, int check_against,
+                      std::shared_ptr<entity_t> owner);
+
+// Moves all projectiles by one tick and applies their impacts. Runs on the
+// main thread after entity physics.
+void projectile_update(game_context_t* ctx);
+
+void projectile_draw(game_context_t* ctx, float alpha);
+
+int projectile_count(const game_context_t* ctx);
+
+#endif // PROJECTILE_H
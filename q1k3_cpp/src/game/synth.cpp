@@ -0,0 +1,534 @@
+#include "synth.h"
+#include "../core/jobs.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+static const int SYNTH_SAMPLERATE = 44100;
+static const int SYNTH_TAB_SIZE = 4096;
+static const int SYNTH_TAB_MASK = SYNTH_TAB_SIZE - 1;
+static const int SYNTH_BLOCK = 256;
+static const int SYNTH_SOUND_ROW_LEN = 5605;
+
+// Bump whenever the synth's output changes, so stale cache files are ignored
+static const uint32_t SYNTH_CACHE_VERSION = 1;
+static const char SYNTH_CACHE_MAGIC[4] = {'Q', '1', 'K', 'S'};
+
+// Oscillator lookup tables: sin, square, saw, tri
+static float synth_tab[SYNTH_TAB_SIZE * 4];
+static std::once_flag synth_tab_once;
+
+static void synth_init_tables() {
+    for (int i = 0; i < SYNTH_TAB_SIZE; i++) {
+        synth_tab[i] = std::sin(i * 6.283184f / SYNTH_TAB_SIZE); // sin
+        synth_tab[i + SYNTH_TAB_SIZE] = synth_tab[i] < 0 ? -1.0f : 1.0f; // square
+        synth_tab[i + SYNTH_TAB_SIZE * 2] = i / float(SYNTH_TAB_SIZE) - 0.5f; // saw
+        synth_tab[i + SYNTH_TAB_SIZE * 3] = i < SYNTH_TAB_SIZE/2
+            ? (i / float(SYNTH_TAB_SIZE/4)) - 1.0f
+            : 3.0f - (i / float(SYNTH_TAB_SIZE/4)); // tri
+    }
+}
+
+// Table position of a phase given in table entries; wraps like the
+// original's (x & mask), negative values included
+static inline int synth_tab_index(double x) {
+    return static_cast<int>(static_cast<int64_t>(x) & SYNTH_TAB_MASK);
+}
+
+// Adds one note of an instrument to buf_l/buf_r at write_pos. The buffers
+// are rings of buf_mask + 1 samples, or plain arrays for a mask of -1;
+// buf_length is the end of the song either way. Samples are
+// rendered back to front like the original, which the oscillator phases and
+// the filter depend on. Each block first computes what has no state (LFO,
+// envelope, panning) for all its samples, then runs the oscillators and the
+// filter, then writes out.
+static void synth_note(const sound_def_t& ins, int row_len, int note, float* buf_l, float* buf_r,
+                       int buf_length, int buf_mask, int write_pos, random_t* random) {
+    int osc_lfo_offset = ins.lfo_waveform * SYNTH_TAB_SIZE;
+    int osc1_offset = ins.osc1_waveform * SYNTH_TAB_SIZE;
+    int osc2_offset = ins.osc2_waveform * SYNTH_TAB_SIZE;
+    double fx_pan_freq = std::pow(2.0, ins.fx_pan_freq - 8) / row_len;
+    double lfo_freq = std::pow(2.0, ins.lfo_freq - 8) / row_len;
+    
+    double c1 = 0;
+    double c2 = 0;
+    
+    double q = ins.fx_resonance / 255.0;
+    double low = 0;
+    double band = 0;
+    double high = 0;
+    
+    int num_samples = ins.attack + ins.sustain + ins.release - 1;
+    
+    double osc1_freq = std::pow(1.059463094, (note + (ins.osc1_oct - 8) * 12 + ins.osc1_det) - 128)
+        * 0.00390625 * (1 + 0.0008 * ins.osc1_detune);
+    double osc2_freq = std::pow(1.059463094, (note + (ins.osc2_oct - 8) * 12 + ins.osc2_det) - 128)
+        * 0.00390625 * (1 + 0.0008 * ins.osc2_detune);
+    
+    double lfor[SYNTH_BLOCK];
+    double envelope[SYNTH_BLOCK];
+    double pan[SYNTH_BLOCK];
+    double out[SYNTH_BLOCK];
+    
+    for (int block_end = num_samples; block_end >= 0; block_end -= SYNTH_BLOCK) {
+        int n = std::min(SYNTH_BLOCK, block_end + 1);
+        
+        // Sample i of the block is j = block_end - i
+        for (int i = 0; i < n; i++) {
+            int j = block_end - i;
+            double k = j + write_pos;
+            lfor[i] = synth_tab[osc_lfo_offset + synth_tab_index(k * lfo_freq * SYNTH_TAB_SIZE)]
+                * ins.lfo_amt / 512.0 + 0.5;
+            pan[i] = synth_tab[synth_tab_index(k * fx_pan_freq * SYNTH_TAB_SIZE)]
+                * ins.fx_pan_amt / 512.0 + 0.5;
+            
+            double e = 1;
+            if (j < ins.attack) {
+                e = static_cast<double>(j) / ins.attack;
+            } else if (j >= ins.attack + ins.sustain) {
+                e -= static_cast<double>(j - ins.attack - ins.sustain) / ins.release;
+            }
+            envelope[i] = e;
+        }
+        
+        for (int i = 0; i < n; i++) {
+            double e = envelope[i];
+            double sample = 0;
+            
+            // Oscillator 1
+            double temp_f = osc1_freq;
+            if (ins.lfo_osc1_freq) {
+                temp_f *= lfor[i];
+            }
+            if (ins.osc1_xenv) {
+                temp_f *= e * e;
+            }
+            c1 += temp_f;
+            sample += synth_tab[osc1_offset + synth_tab_index(c1 * SYNTH_TAB_SIZE)] * ins.osc1_vol;
+            
+            // Oscillator 2
+            temp_f = osc2_freq;
+            if (ins.osc2_xenv) {
+                temp_f *= e * e;
+            }
+            c2 += temp_f;
+            sample += synth_tab[osc2_offset + synth_tab_index(c2 * SYNTH_TAB_SIZE)] * ins.osc2_vol;
+            
+            // Noise oscillator
+            if (ins.noise_fader) {
+                sample += (2 * random_float(random) - 1) * ins.noise_fader * e;
+            }
+            
+            sample *= e / 255;
+            
+            // State variable filter
+            double filter_f = ins.fx_freq;
+            if (ins.lfo_fx_freq) {
+                filter_f *= lfor[i];
+            }
+            filter_f = 1.5 * synth_tab[synth_tab_index(filter_f * 0.5 / SYNTH_SAMPLERATE * SYNTH_TAB_SIZE)];
+            low += filter_f * band;
+            high = q * (sample - band) - low;
+            band += filter_f * high;
+            switch (ins.fx_filter) {
+                case 1: sample = high; break;
+                case 2: sample = low; break;
+                case 3: sample = band; break;
+                case 4: sample = low + high; break;
+                default: break;
+            }
+            
+            out[i] = sample * 0.00476 * ins.master; // 39 / 8192 = 0.00476
+        }
+        
+        // Panning; samples past the end of the buffer are cut off
+        for (int i = 0; i < n; i++) {
+            int k = block_end - i + write_pos;
+            if (k < buf_length) {
+                buf_l[k & buf_mask] += out[i] * (1 - pan[i]);
+                buf_r[k & buf_mask] += out[i] * pan[i];
+            }
+        }
+    }
+}
+
+static void synth_delay(int shift, double amount, float* buf_l, float* buf_r, int length) {
+    for (int i = 0; i < length - shift; i++) {
+        buf_l[i + shift] += buf_r[i] * amount;
+        buf_r[i + shift] += buf_l[i] * amount;
+    }
+}
+
+static int synth_delay_shift(const sound_def_t& ins, int row_len) {
+    return (ins.fx_delay_time * row_len) >> 1;
+}
+
+// Note played in a row of the whole song (32 rows per pattern), 0 for none
+static int synth_track_note(const synth_track_t& track, int song_row) {
+    int p = song_row / 32;
+    int row = song_row % 32;
+    int pattern = p < static_cast<int>(track.sequence.size()) ? track.sequence[p] - 1 : -1;
+    if (pattern >= 0 && pattern < static_cast<int>(track.patterns.size()) &&
+        row < static_cast<int>(track.patterns[pattern].size())) {
+        return track.patterns[pattern][row];
+    }
+    return 0;
+}
+
+static void synth_track(const synth_song_t& song, const synth_track_t& track, float* buf_l, float* buf_r,
+                        int length, random_t* random) {
+    for (int row = 0; row < song.pattern_len * 32; row++) {
+        int note = synth_track_note(track, row);
+        if (note) {
+            synth_note(track.instrument, song.row_len, note, buf_l, buf_r, length, -1,
+                       row * song.row_len, random);
+        }
+    }
+    synth_delay(synth_delay_shift(track.instrument, song.row_len),
+                track.instrument.fx_delay_amt / 255.0, buf_l, buf_r, length);
+}
+
+static audio_buffer_t* synth_buffer(const float* buf_l, const float* buf_r, int length) {
+    audio_buffer_t* buffer = new audio_buffer_t();
+    buffer->length = length;
+    buffer->channels = 2;
+    buffer->priority = 0;
+    buffer->loop = false;
+    buffer->data = new float[length * 2];
+    for (int i = 0; i < length; i++) {
+        buffer->data[i * 2] = buf_l[i];
+        buffer->data[i * 2 + 1] = buf_r[i];
+    }
+    return buffer;
+}
+
+static int synth_sound_length(const sound_def_t& ins) {
+    int delay_shift = synth_delay_shift(ins, SYNTH_SOUND_ROW_LEN);
+    return static_cast<int>(ins.attack + ins.sustain + ins.release +
+                            delay_shift * 32 * (ins.fx_delay_amt / 255.0));
+}
+
+// Frames a request renders to
+static int synth_request_length(const synth_request_t& request) {
+    return request.song ? SYNTH_SAMPLERATE * request.song->song_len :
+        synth_sound_length(*request.instrument);
+}
+
+static void synth_sound(const sound_def_t& ins, int note, float* buf_l, float* buf_r, int length,
+                        random_t* random) {
+    synth_note(ins, SYNTH_SOUND_ROW_LEN, note, buf_l, buf_r, length, -1, 0, random);
+    synth_delay(synth_delay_shift(ins, SYNTH_SOUND_ROW_LEN), ins.fx_delay_amt / 255.0,
+                buf_l, buf_r, length);
+}
+
+// FNV-1a over everything that goes into a render
+static void synth_hash_ints(uint64_t& hash, const int* values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t v = static_cast<uint32_t>(values[i]);
+        for (int b = 0; b < 4; b++) {
+            hash = (hash ^ ((v >> (b * 8)) & 0xff)) * 1099511628211ull;
+        }
+    }
+}
+
+static void synth_hash_instrument(uint64_t& hash, const sound_def_t& d) {
+    const int values[] = {
+        d.osc1_oct, d.osc1_det, d.osc1_detune, d.osc1_xenv, d.osc1_vol, d.osc1_waveform,
+        d.osc2_oct, d.osc2_det, d.osc2_detune, d.osc2_xenv, d.osc2_vol, d.osc2_waveform,
+        d.noise_fader, d.attack, d.sustain, d.release, d.master,
+        d.fx_filter, d.fx_freq, d.fx_resonance, d.fx_delay_time, d.fx_delay_amt, d.fx_pan_freq, d.fx_pan_amt,
+        d.lfo_osc1_freq, d.lfo_fx_freq, d.lfo_freq, d.lfo_amt, d.lfo_waveform
+    };
+    synth_hash_ints(hash, values, sizeof(values) / sizeof(values[0]));
+}
+
+static uint64_t synth_hash(const synth_request_t& request) {
+    uint64_t hash = 14695981039346656037ull;
+    int header[] = {static_cast<int>(SYNTH_CACHE_VERSION), request.song ? 1 : 0, request.note};
+    synth_hash_ints(hash, header, 3);
+    if (!request.song) {
+        synth_hash_instrument(hash, *request.instrument);
+        return hash;
+    }
+    
+    const synth_song_t& song = *request.song;
+    int params[] = {song.row_len, song.pattern_len, song.song_len, static_cast<int>(song.tracks.size())};
+    synth_hash_ints(hash, params, 4);
+    for (const auto& track : song.tracks) {
+        synth_hash_instrument(hash, track.instrument);
+        int sizes[] = {static_cast<int>(track.sequence.size()), static_cast<int>(track.patterns.size())};
+        synth_hash_ints(hash, sizes, 2);
+        synth_hash_ints(hash, track.sequence.data(), track.sequence.size());
+        for (const auto& pattern : track.patterns) {
+            int size = static_cast<int>(pattern.size());
+            synth_hash_ints(hash, &size, 1);
+            synth_hash_ints(hash, pattern.data(), pattern.size());
+        }
+    }
+    return hash;
+}
+
+static std::string synth_cache_path(const std::string& cache_dir, uint64_t hash) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.pcm", static_cast<unsigned long long>(hash));
+    return cache_dir + "/" + name;
+}
+
+// Cache files: magic, version, number of frames, interleaved stereo floats.
+// Anything but exactly the expected number of frames, with the file holding
+// all of them, is treated as a miss.
+static audio_buffer_t* synth_cache_load(const std::string& path, int expected_length) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return nullptr;
+    }
+    std::streamoff file_size = file.tellg();
+    file.seekg(0);
+    
+    char magic[4];
+    uint32_t version = 0;
+    uint32_t length = 0;
+    file.read(magic, 4);
+    file.read(reinterpret_cast<char*>(&version), 4);
+    file.read(reinterpret_cast<char*>(&length), 4);
+    if (!file || std::memcmp(magic, SYNTH_CACHE_MAGIC, 4) || version != SYNTH_CACHE_VERSION) {
+        return nullptr;
+    }
+    std::streamoff data_size = static_cast<std::streamoff>(length) * 2 * sizeof(float);
+    if (static_cast<int64_t>(length) != expected_length || file_size - 12 != data_size) {
+        std::cerr << "Ignoring bad sound cache file " << path << std::endl;
+        return nullptr;
+    }
+    
+    auto buffer = std::make_unique<audio_buffer_t>();
+    buffer->length = expected_length;
+    buffer->channels = 2;
+    buffer->priority = 0;
+    buffer->loop = false;
+    buffer->data = new float[static_cast<size_t>(expected_length) * 2];
+    file.read(reinterpret_cast<char*>(buffer->data), data_size);
+    if (!file) {
+        std::cerr << "Truncated sound cache file " << path << std::endl;
+        delete[] buffer->data;
+        return nullptr;
+    }
+    return buffer.release();
+}
+
+// Written under a temporary name first, so a crash never leaves a
+// truncated file behind under the real one
+static void synth_cache_store(const std::string& path, const audio_buffer_t* buffer) {
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary);
+        uint32_t length = static_cast<uint32_t>(buffer->length);
+        file.write(SYNTH_CACHE_MAGIC, 4);
+        file.write(reinterpret_cast<const char*>(&SYNTH_CACHE_VERSION), 4);
+        file.write(reinterpret_cast<const char*>(&length), 4);
+        file.write(reinterpret_cast<const char*>(buffer->data), length * 2 * sizeof(float));
+        if (!file) {
+            std::cerr << "Failed to write sound cache file " << temp_path << std::endl;
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+    if (error) {
+        std::cerr << "Failed to write sound cache file " << path << ": " << error.message() << std::endl;
+    }
+}
+
+audio_buffer_t* synth_render_sound(const sound_def_t& instrument, int note) {
+    synth_request_t request = {&instrument, note, nullptr, nullptr};
+    synth_render_all(&request, 1, "");
+    return request.result;
+}
+
+audio_buffer_t* synth_render_song(const synth_song_t& song) {
+    synth_request_t request = {nullptr, 0, &song, nullptr};
+    synth_render_all(&request, 1, "");
+    return request.result;
+}
+
+// One piece of work for the job threads: a sound, or one track of a song
+struct synth_unit_t {
+    int request;
+    int track;      // -1 for sounds
+    std::vector<float> buf_l;
+    std::vector<float> buf_r;
+};
+
+void synth_render_all(synth_request_t* requests, int count, const std::string& cache_dir) {
+    std::call_once(synth_tab_once, synth_init_tables);
+    
+    if (!cache_dir.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(cache_dir, error);
+        if (error) {
+            std::cerr << "Failed to create sound cache " << cache_dir << ": " << error.message() << std::endl;
+        }
+    }
+    
+    // Whatever is not in the cache is split into units
+    std::vector<uint64_t> hashes(count);
+    std::vector<synth_unit_t> units;
+    for (int r = 0; r < count; r++) {
+        synth_request_t& request = requests[r];
+        hashes[r] = synth_hash(request);
+        request.result = cache_dir.empty() ? nullptr :
+            synth_cache_load(synth_cache_path(cache_dir, hashes[r]), synth_request_length(request));
+        if (request.result) {
+            continue;
+        }
+        if (!request.song) {
+            units.push_back({r, -1, {}, {}});
+            continue;
+        }
+        for (int t = 0; t < static_cast<int>(request.song->tracks.size()); t++) {
+            units.push_back({r, t, {}, {}});
+        }
+    }
+    
+    // The longest units (songs) are listed last; start them first
+    std::reverse(units.begin(), units.end());
+    jobs_parallel_for(static_cast<int>(units.size()), 1, [&](int begin, int end) {
+        for (int u = begin; u < end; u++) {
+            synth_unit_t& unit = units[u];
+            const synth_request_t& request = requests[unit.request];
+            
+            // Noise comes from a stream of its own for each unit, so the
+            // result doesn't depend on the order the units are rendered in
+            random_t random;
+            random_seed(&random, hashes[unit.request], unit.track + 1);
+            
+            int length = synth_request_length(request);
+            unit.buf_l.assign(length, 0.0f);
+            unit.buf_r.assign(length, 0.0f);
+            if (request.song) {
+                synth_track(*request.song, request.song->tracks[unit.track],
+                            unit.buf_l.data(), unit.buf_r.data(), length, &random);
+            } else {
+                synth_sound(*request.instrument, request.note,
+                            unit.buf_l.data(), unit.buf_r.data(), length, &random);
+            }
+        }
+    });
+    std::reverse(units.begin(), units.end());
+    
+    // Mix the tracks of songs in track order and build the buffers
+    for (size_t u = 0; u < units.size();) {
+        synth_request_t& request = requests[units[u].request];
+        size_t last = u + 1;
+        while (last < units.size() && units[last].request == units[u].request) {
+            last++;
+        }
+        for (size_t t = u + 1; t < last; t++) {
+            for (size_t i = 0; i < units[u].buf_l.size(); i++) {
+                units[u].buf_l[i] += units[t].buf_l[i];
+                units[u].buf_r[i] += units[t].buf_r[i];
+            }
+            units[t].buf_l = std::vector<float>();
+            units[t].buf_r = std::vector<float>();
+        }
+        request.result = synth_buffer(units[u].buf_l.data(), units[u].buf_r.data(),
+                                      static_cast<int>(units[u].buf_l.size()));
+        if (!cache_dir.empty()) {
+            synth_cache_store(synth_cache_path(cache_dir, hashes[units[u].request]), request.result);
+        }
+        u = last;
+    }
+}
+
+static void synth_stream_rewind(synth_stream_t* stream) {
+    stream->position = 0;
+    for (int t = 0; t < static_cast<int>(stream->tracks.size()); t++) {
+        synth_stream_track_t& track = stream->tracks[t];
+        std::fill(track.buf_l.begin(), track.buf_l.end(), 0.0f);
+        std::fill(track.buf_r.begin(), track.buf_r.end(), 0.0f);
+        track.next_row = 0;
+        random_seed(&track.random, stream->hash, t + 1);
+    }
+}
+
+void synth_stream_init(synth_stream_t* stream, const synth_song_t* song) {
+    std::call_once(synth_tab_once, synth_init_tables);
+    
+    // Seeded like synth_render_all() seeds the song's tracks
+    synth_request_t request = {nullptr, 0, song, nullptr};
+    stream->song = song;
+    stream->hash = synth_hash(request);
+    stream->length = SYNTH_SAMPLERATE * song->song_len;
+    stream->tracks.resize(song->tracks.size());
+    
+    // A note rendered at the start of its row must fit in the ring, and so
+    // must the echo of the last sample of it
+    for (size_t t = 0; t < song->tracks.size(); t++) {
+        const sound_def_t& ins = song->tracks[t].instrument;
+        synth_stream_track_t& track = stream->tracks[t];
+        track.delay_shift = synth_delay_shift(ins, song->row_len);
+        track.delay_amount = ins.fx_delay_amt / 255.0;
+        int reach = ins.attack + ins.sustain + ins.release + track.delay_shift + 1;
+        int size = 1;
+        while (size < reach) {
+            size <<= 1;
+        }
+        track.mask = size - 1;
+        track.buf_l.assign(size, 0.0f);
+        track.buf_r.assign(size, 0.0f);
+    }
+    synth_stream_rewind(stream);
+}
+
+void synth_stream_render(synth_stream_t* stream, float* out, int frames) {
+    const synth_song_t& song = *stream->song;
+    while (frames > 0) {
+        if (stream->position >= stream->length) {
+            synth_stream_rewind(stream);
+        }
+        
+        // Up to the end of the current row at most, so all notes that reach
+        // into these frames are known
+        int row = stream->position / song.row_len;
+        int n = std::min({frames, (row + 1) * song.row_len - stream->position,
+                          stream->length - stream->position});
+        std::fill(out, out + n * 2, 0.0f);
+        
+        for (size_t t = 0; t < song.tracks.size(); t++) {
+            const synth_track_t& track = song.tracks[t];
+            synth_stream_track_t& state = stream->tracks[t];
+            float* buf_l = state.buf_l.data();
+            float* buf_r = state.buf_r.data();
+            int mask = state.mask;
+            for (; state.next_row <= row; state.next_row++) {
+                int note = synth_track_note(track, state.next_row);
+                if (note) {
+                    synth_note(track.instrument, song.row_len, note, buf_l, buf_r, stream->length, mask,
+                               state.next_row * song.row_len, &state.random);
+                }
+            }
+            
+            // These frames are complete now: echo them forward, hand them
+            // out and free their place in the ring
+            for (int i = 0; i < n; i++) {
+                int k = stream->position + i;
+                if (k < stream->length - state.delay_shift) {
+                    buf_l[(k + state.delay_shift) & mask] += buf_r[k & mask] * state.delay_amount;
+                    buf_r[(k + state.delay_shift) & mask] += buf_l[k & mask] * state.delay_amount;
+                }
+                out[i * 2] += buf_l[k & mask];
+                out[i * 2 + 1] += buf_r[k & mask];
+                buf_l[k & mask] = 0;
+                buf_r[k & mask] = 0;
+            }
+        }
+        
+        stream->position += n;
+        out += n * 2;
+        frames -= n;
+    }
+}
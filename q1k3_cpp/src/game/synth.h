@@ -0,0 +1,74 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include "audio.h"
+#include "../core/random.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Sonant-X software synth (zlib license; Copyright (c) 2014 Nicolas Vanhoren,
+// 2011 Marcus Geelnard, 2008-2009 Jake Taylor), as modified for q1k3. Renders
+// instruments (sound_def_t) to stereo PCM, either a single note for sound
+// effects or whole songs of note patterns.
+
+// One instrument of a song. sequence lists the pattern (1-based, 0 for
+// none) played in each slot; patterns hold one note per row, 32 rows each.
+struct synth_track_t {
+    sound_def_t instrument;
+    std::vector<int> sequence;
+    std::vector<std::vector<int>> patterns;
+};
+
+struct synth_song_t {
+    int row_len;        // samples per row
+    int pattern_len;    // slots per track
+    int song_len;       // seconds
+    std::vector<synth_track_t> tracks;
+};
+
+// A sound effect (song == nullptr) or a song to render
+struct synth_request_t {
+    const sound_def_t* instrument;
+    int note;
+    const synth_song_t* song;
+    audio_buffer_t* result;
+};
+
+// Renders all requests, in parallel on the job threads. Results are cached
+// in cache_dir (empty for no cache) keyed by a hash of their definition, so
+// only sounds that changed are rendered again.
+void synth_render_all(synth_request_t* requests, int count, const std::string& cache_dir);
+
+// Single renders, on the calling thread
+audio_buffer_t* synth_render_sound(const sound_def_t& instrument, int note);
+audio_buffer_t* synth_render_song(const synth_song_t& song);
+
+// Incremental song rendering, for music that is played while it is made
+// instead of being rendered up front. Each track keeps a ring just long
+// enough for its longest note plus its delay; notes are rendered when
+// their row comes up. The output is that of synth_render_song(), looped.
+struct synth_stream_track_t {
+    std::vector<float> buf_l;
+    std::vector<float> buf_r;
+    int mask;           // ring size - 1
+    int next_row;       // first row whose notes are not rendered yet
+    int delay_shift;
+    double delay_amount;
+    random_t random;
+};
+
+struct synth_stream_t {
+    const synth_song_t* song;
+    uint64_t hash;
+    int length;         // frames in one pass of the song
+    int position;       // next frame to be returned
+    std::vector<synth_stream_track_t> tracks;
+};
+
+void synth_stream_init(synth_stream_t* stream, const synth_song_t* song);
+
+// The next frames of the song as interleaved stereo; starts over at the end
+void synth_stream_render(synth_stream_t* stream, float* out, int frames);
+
+#endif // SYNTH_H
@@ -1,35 +1,176 @@
 #include "timer.h"
 #include "game.h"
+#include <cmath>
 
-// Static member definition
-std::vector<Timer::TimerEntry> Timer::timers;
+Timer::Timer() : free_head(-1), due_head(-1), due_tail(-1), processed_tick(-1), clear_count(0), num_pending(0) {
+    for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+        slots[i] = -1;
+        slot_tails[i] = -1;
+    }
+}
 
-void Timer::setTimeout(Callback callback, int delay_ms) {
-    TimerEntry entry;
-    entry.callback = callback;
-    entry.trigger_time = game_time + (delay_ms / 1000.0f);
+static int64_t timer_tick(float time) {
+    return static_cast<int64_t>(std::floor(time / TIMER_SLOT_TIME));
+}
+
+// Appended, so timers due in the same tick fire in the order they were set
+void Timer::link(int32_t index, int64_t tick) {
+    entry_t& entry = entries[index];
+    int slot = tick & (TIMER_WHEEL_SLOTS - 1);
+    entry.slot_tick = tick;
+    entry.due = false;
+    entry.prev = slot_tails[slot];
+    entry.next = -1;
+    if (slot_tails[slot] >= 0) {
+        entries[slot_tails[slot]].next = index;
+    } else {
+        slots[slot] = index;
+    }
+    slot_tails[slot] = index;
+}
+
+void Timer::link_due(int32_t index) {
+    entry_t& entry = entries[index];
+    entry.due = true;
+    entry.prev = due_tail;
+    entry.next = -1;
+    if (due_tail >= 0) {
+        entries[due_tail].next = index;
+    } else {
+        due_head = index;
+    }
+    due_tail = index;
+}
+
+void Timer::unlink(int32_t index) {
+    entry_t& entry = entries[index];
+    int slot = entry.slot_tick & (TIMER_WHEEL_SLOTS - 1);
+    int32_t& head = entry.due ? due_head : slots[slot];
+    int32_t& tail = entry.due ? due_tail : slot_tails[slot];
+    if (entry.prev >= 0) {
+        entries[entry.prev].next = entry.next;
+    } else {
+        head = entry.next;
+    }
+    if (entry.next >= 0) {
+        entries[entry.next].prev = entry.prev;
+    } else {
+        tail = entry.prev;
+    }
+}
+
+void Timer::release(int32_t index) {
+    entry_t& entry = entries[index];
+    entry.callback.reset();
+    entry.active = false;
+    entry.generation++;
+    entry.next = free_head;
+    free_head = index;
+    num_pending--;
+}
+
+timer_handle_t Timer::setTimeout(timer_callback_t callback, float trigger_time) {
+    int32_t index;
+    if (free_head >= 0) {
+        index = free_head;
+        free_head = entries[index].next;
+    } else {
+        index = static_cast<int32_t>(entries.size());
+        entries.emplace_back();
+        entries[index].generation = 0;
+    }
+    
+    entry_t& entry = entries[index];
+    entry.callback = std::move(callback);
+    entry.trigger_time = trigger_time;
     entry.active = true;
+    num_pending++;
+    
+    // Never into a slot that was already fired
+    int64_t tick = timer_tick(trigger_time);
+    if (tick <= processed_tick) {
+        tick = processed_tick + 1;
+    }
+    link(index, tick);
     
-    timers.push_back(entry);
+    return {static_cast<uint32_t>(index), entry.generation};
+}
+
+bool Timer::cancel(timer_handle_t handle) {
+    if (handle.index >= entries.size()) {
+        return false;
+    }
+    entry_t& entry = entries[handle.index];
+    if (!entry.active || entry.generation != handle.generation) {
+        return false;
+    }
+    unlink(handle.index);
+    release(handle.index);
+    return true;
 }
 
 void Timer::update(float current_time) {
-    // Process all timers
-    for (auto& timer : timers) {
-        if (timer.active && current_time >= timer.trigger_time) {
-            timer.callback();
-            timer.active = false;
-        }
+    int64_t now = timer_tick(current_time);
+    if (processed_tick < 0) {
+        // First update after clear(): look at every slot once
+        processed_tick = now - TIMER_WHEEL_SLOTS;
     }
     
-    // Remove inactive timers
-    timers.erase(
-        std::remove_if(timers.begin(), timers.end(),
-            [](const TimerEntry& t) { return !t.active; }),
-        timers.end()
-    );
+    // Normally one slot per tick; after a long pause at most one turn
+    int64_t first = std::max(processed_tick + 1, now - TIMER_WHEEL_SLOTS + 1);
+    uint32_t clears = clear_count;
+    
+    for (int64_t tick = first; tick <= now; tick++) {
+        processed_tick = tick;
+        
+        // Move the due timers over to the due list first, so callbacks
+        // can't change the slot while it is walked
+        int32_t index = slots[tick & (TIMER_WHEEL_SLOTS - 1)];
+        while (index >= 0) {
+            int32_t next = entries[index].next;
+            entry_t& entry = entries[index];
+            if (entry.trigger_time <= current_time) {
+                unlink(index);
+                link_due(index);
+            } else if (entry.slot_tick <= tick) {
+                // Due within this tick but after current_time
+                unlink(index);
+                link(index, now + 1);
+            }
+            index = next;
+        }
+        
+        // The callbacks may schedule, cancel (also timers still on the due
+        // list) or clear timers, and grow the entries
+        while (due_head >= 0) {
+            index = due_head;
+            unlink(index);
+            timer_callback_t callback = std::move(entries[index].callback);
+            release(index);
+            callback();
+            if (clears != clear_count) {
+                return;
+            }
+        }
+    }
 }
 
 void Timer::clear() {
-    timers.clear();
+    for (int32_t i = 0; i < static_cast<int32_t>(entries.size()); i++) {
+        if (entries[i].active) {
+            release(i);
+        }
+    }
+    for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+        slots[i] = -1;
+        slot_tails[i] = -1;
+    }
+    due_head = -1;
+    due_tail = -1;
+    processed_tick = -1;
+    clear_count++;
+}
+
+timer_handle_t setTimeout(game_context_t* ctx, timer_callback_t callback, int delay_ms) {
+    return ctx->timers.setTimeout(std::move(callback), ctx->time + (delay_ms / 1000.0f));
 }
\ No newline at end of file
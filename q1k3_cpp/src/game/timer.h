@@ -1,38 +1,138 @@
 #ifndef TIMER_H
 #define TIMER_H
 
-#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include <vector>
-#include <chrono>
 
-// Timer system to replace JavaScript setTimeout
+struct game_context_t;
+
+// Callback stored inline (no heap allocation). Captures must fit into
+// TIMER_CALLBACK_SIZE bytes; a pointer or two is all the game needs.
+const size_t TIMER_CALLBACK_SIZE = 32;
+
+class timer_callback_t {
+public:
+    timer_callback_t() : invoke_fn(nullptr), relocate_fn(nullptr), destroy_fn(nullptr) {}
+    
+    template<typename F, typename = typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type, timer_callback_t>::value>::type>
+    timer_callback_t(F f) {
+        static_assert(sizeof(F) <= TIMER_CALLBACK_SIZE, "timer callback captures too much");
+        static_assert(alignof(F) <= alignof(std::max_align_t), "timer callback alignment");
+        new (storage) F(std::move(f));
+        invoke_fn = [](void* s) { (*static_cast<F*>(s))(); };
+        relocate_fn = [](void* dst, void* src) {
+            new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        };
+        destroy_fn = [](void* s) { static_cast<F*>(s)->~F(); };
+    }
+    
+    timer_callback_t(timer_callback_t&& other) : timer_callback_t() {
+        *this = std::move(other);
+    }
+    
+    timer_callback_t& operator=(timer_callback_t&& other) {
+        if (this != &other) {
+            reset();
+            if (other.invoke_fn) {
+                other.relocate_fn(storage, other.storage);
+                invoke_fn = other.invoke_fn;
+                relocate_fn = other.relocate_fn;
+                destroy_fn = other.destroy_fn;
+                other.invoke_fn = nullptr;
+            }
+        }
+        return *this;
+    }
+    
+    timer_callback_t(const timer_callback_t&) = delete;
+    timer_callback_t& operator=(const timer_callback_t&) = delete;
+    ~timer_callback_t() { reset(); }
+    
+    void operator()() { invoke_fn(storage); }
+    explicit operator bool() const { return invoke_fn != nullptr; }
+    
+    void reset() {
+        if (invoke_fn) {
+            destroy_fn(storage);
+            invoke_fn = nullptr;
+        }
+    }
+    
+private:
+    alignas(std::max_align_t) unsigned char storage[TIMER_CALLBACK_SIZE];
+    void (*invoke_fn)(void*);
+    void (*relocate_fn)(void*, void*);
+    void (*destroy_fn)(void*);
+};
+
+// Returned by setTimeout() to cancel a timer that hasn't fired yet. Stale
+// handles (fired, cancelled or cleared timers) are ignored.
+struct timer_handle_t {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+// Timer system to replace JavaScript setTimeout. Every game context has one.
+//
+// Timers sit in a hashed timing wheel of TIMER_WHEEL_SLOTS slots, one per
+// tick, in intrusive lists through a pool of entries. Scheduling, cancelling
+// and firing are O(1); timers further out than one turn of the wheel wait in
+// their slot until their time has come. Entries are recycled, so once the
+// pool has grown to the number of timers in flight nothing is allocated.
+const int TIMER_WHEEL_SLOTS = 256;
+const float TIMER_SLOT_TIME = 1.0f / 60;    // one game tick
+
 class Timer {
 public:
-    using Callback = std::function<void()>;
+    Timer();
+    
+    // Schedule a callback at game time trigger_time
+    timer_handle_t setTimeout(timer_callback_t callback, float trigger_time);
+    
+    // Returns false if the timer already fired or was cancelled
+    bool cancel(timer_handle_t handle);
+    
+    // Fire all timers due at current_time (called each tick)
+    void update(float current_time);
+    
+    // Drop all timers; safe to call from a timer callback
+    void clear();
+    
+    int pending() const { return num_pending; }
     
 private:
-    struct TimerEntry {
-        Callback callback;
+    struct entry_t {
+        timer_callback_t callback;
         float trigger_time;
+        int64_t slot_tick;      // tick of the slot it is linked into
+        uint32_t generation;
+        int32_t prev, next;     // in the slot's list, the due list or the free list
         bool active;
+        bool due;               // taken out of its slot to be fired
     };
     
-    static std::vector<TimerEntry> timers;
-    
-public:
-    // Schedule a callback after delay_ms milliseconds
-    static void setTimeout(Callback callback, int delay_ms);
-    
-    // Update all timers (called each frame)
-    static void update(float current_time);
+    std::vector<entry_t> entries;
+    int32_t free_head;
+    int32_t slots[TIMER_WHEEL_SLOTS];       // list heads
+    int32_t slot_tails[TIMER_WHEEL_SLOTS];
+    int32_t due_head, due_tail;             // timers update() is firing
+    int64_t processed_tick;     // last tick whose slot was fired
+    uint32_t clear_count;       // detects clear() from inside a callback
+    int num_pending;
     
-    // Clear all timers
-    static void clear();
+    void link(int32_t index, int64_t tick);
+    void link_due(int32_t index);
+    void unlink(int32_t index);
+    void release(int32_t index);
 };
 
-// Global helper function matching JavaScript API
-inline void setTimeout(std::function<void()> callback, int delay_ms) {
-    Timer::setTimeout(callback, delay_ms);
-}
+// Helper matching the JavaScript API; delay_ms from the context's game time
+timer_handle_t setTimeout(game_context_t* ctx, timer_callback_t callback, int delay_ms);
 
 #endif // TIMER_H
\ No newline at end of file
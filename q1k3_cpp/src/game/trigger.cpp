@@ -0,0 +1,138 @@
+#include "trigger.h"
+#include "entity.h"
+#include "entity_player.h"
+#include <algorithm>
+#include <cmath>
+
+static uint32_t trigger_cell(const vec3& pos) {
+    uint32_t x = static_cast<uint32_t>(static_cast<int>(std::floor(pos.x / TRIGGER_CELL))) & 1023;
+    uint32_t y = static_cast<uint32_t>(static_cast<int>(std::floor(pos.y / TRIGGER_CELL))) & 1023;
+    uint32_t z = static_cast<uint32_t>(static_cast<int>(std::floor(pos.z / TRIGGER_CELL))) & 1023;
+    return x | (y << 10) | (z << 20);
+}
+
+static void trigger_grid_remove(trigger_system_t& ts, int handle) {
+    auto it = ts.grid.find(ts.volumes[handle].cell);
+    if (it != ts.grid.end()) {
+        std::vector<int>& cell = it->second;
+        cell.erase(std::remove(cell.begin(), cell.end(), handle), cell.end());
+    }
+}
+
+void trigger_clear(game_context_t* ctx) {
+    trigger_system_t& ts = ctx->triggers;
+    ts.volumes.clear();
+    ts.free_volumes.clear();
+    ts.grid.clear();
+    ts.candidates.clear();
+    ts.tracked_cell = UINT32_MAX;
+    ts.version++;
+}
+
+int trigger_add(game_context_t* ctx, entity_t* owner, const vec3& center, float radius) {
+    trigger_system_t& ts = ctx->triggers;
+    int handle;
+    if (!ts.free_volumes.empty()) {
+        handle = ts.free_volumes.back();
+        ts.free_volumes.pop_back();
+    } else {
+        handle = static_cast<int>(ts.volumes.size());
+        ts.volumes.push_back(trigger_t());
+    }
+    
+    ts.volumes[handle] = {owner, center, radius, trigger_cell(center), false, true};
+    ts.grid[ts.volumes[handle].cell].push_back(handle);
+    ts.version++;
+    return handle;
+}
+
+void trigger_move(game_context_t* ctx, int handle, const vec3& center) {
+    trigger_system_t& ts = ctx->triggers;
+    trigger_t& volume = ts.volumes[handle];
+    volume.center = center;
+    
+    uint32_t cell = trigger_cell(center);
+    if (cell != volume.cell) {
+        trigger_grid_remove(ts, handle);
+        volume.cell = cell;
+        ts.grid[cell].push_back(handle);
+        ts.version++;
+    }
+}
+
+void trigger_remove(game_context_t* ctx, int handle) {
+    trigger_system_t& ts = ctx->triggers;
+    trigger_grid_remove(ts, handle);
+    ts.volumes[handle].used = false;
+    ts.volumes[handle].owner = nullptr;
+    ts.free_volumes.push_back(handle);
+    ts.version++;
+}
+
+void trigger_update(game_context_t* ctx) {
+    trigger_system_t& ts = ctx->triggers;
+    entity_t* player = ctx->entity_player.get();
+    if (!player || player->_dead) {
+        return;
+    }
+    
+    // Gather the volumes of the 27 cells around the player, sorted so
+    // events are raised in the same order every time
+    vec3 pos = player->p;
+    uint32_t cell = trigger_cell(pos);
+    if (cell != ts.tracked_cell || ts.version != ts.candidates_version) {
+        std::vector<int> previous;
+        previous.swap(ts.candidates);
+        for (int dz = -1; dz <= 1; dz++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    auto it = ts.grid.find(trigger_cell(pos + vec3(dx, dy, dz) * TRIGGER_CELL));
+                    if (it != ts.grid.end()) {
+                        ts.candidates.insert(ts.candidates.end(), it->second.begin(), it->second.end());
+                    }
+                }
+            }
+        }
+        std::sort(ts.candidates.begin(), ts.candidates.end());
+        
+        // Volumes left behind while the player was inside them
+        for (int handle : previous) {
+            trigger_t& volume = ts.volumes[handle];
+            if (volume.used && volume.inside &&
+                !std::binary_search(ts.candidates.begin(), ts.candidates.end(), handle)) {
+                volume.inside = false;
+                ts.events.push_back({volume.owner, false});
+            }
+        }
+        
+        ts.tracked_cell = cell;
+        ts.candidates_version = ts.version;
+    }
+    
+    for (int handle : ts.candidates) {
+        trigger_t& volume = ts.volumes[handle];
+        bool inside = vec3_dist(volume.center, pos) < volume.radius;
+        if (inside != volume.inside) {
+            volume.inside = inside;
+            ts.events.push_back({volume.owner, inside});
+        }
+    }
+    
+    // Handlers may add or remove volumes, so they run after the tests.
+    // Entities are only destroyed at the end of the tick.
+    std::vector<std::pair<entity_t*, bool>> events;
+    events.swap(ts.events);
+    for (const auto& event : events) {
+        entity_t* owner = event.first;
+        if (owner->_dead) {
+            continue;
+        }
+        if (event.second) {
+            owner->_trigger_enter(player);
+        } else {
+            owner->_trigger_exit(player);
+        }
+    }
+    events.clear();
+    ts.events.swap(events);
+}
@@ -0,0 +1,52 @@
+#ifndef TRIGGER_H
+#define TRIGGER_H
+
+#include "../core/vec3.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct game_context_t;
+class entity_t;
+
+// Spheres the player can walk into (pickups, doors, level exits). Volumes
+// are kept in a grid of TRIGGER_CELL sized cells. The volumes around the
+// player are only looked up again when the player enters another cell or a
+// volume changes cell; just those few are tested each tick. The owner gets
+// _trigger_enter() / _trigger_exit() when the player crosses the surface.
+const float TRIGGER_CELL = 256;     // must be >= the largest radius
+
+struct trigger_t {
+    entity_t* owner;
+    vec3 center;
+    float radius;
+    uint32_t cell;
+    bool inside;
+    bool used;
+};
+
+struct trigger_system_t {
+    std::vector<trigger_t> volumes;   // handle = index
+    std::vector<int> free_volumes;
+    std::unordered_map<uint32_t, std::vector<int>> grid;
+    
+    // Volumes near the tracked entity, valid for tracked_cell & version
+    std::vector<int> candidates;
+    uint32_t tracked_cell = UINT32_MAX;
+    uint32_t version = 0;
+    uint32_t candidates_version = UINT32_MAX;
+    
+    // Events of one update, dispatched after all volumes were tested
+    std::vector<std::pair<entity_t*, bool>> events;   // owner, entered
+};
+
+void trigger_clear(game_context_t* ctx);
+int trigger_add(game_context_t* ctx, entity_t* owner, const vec3& center, float radius);
+void trigger_move(game_context_t* ctx, int handle, const vec3& center);
+void trigger_remove(game_context_t* ctx, int handle);
+
+// Test the player against the volumes around it and raise enter/exit
+// events; called once per tick after movement
+void trigger_update(game_context_t* ctx);
+
+#endif // TRIGGER_H
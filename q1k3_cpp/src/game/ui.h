@@ -2,7 +2,6 @@
 #define UI_H
 
 #include <string>
-#include <GL/glew.h>
 
 class UI {
 private:
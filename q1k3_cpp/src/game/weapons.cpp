@@ -1,9 +1,9 @@
 #include "weapons.h"
 #include "entity.h"
 #include "timer.h"
-#include "../platform/platform.h"
+#include "hitscan.h"
+#include "entity_player.h"
 #include "../renderer/renderer.h"
-#include <cstdlib>
 #include <functional>
 
 // Sound effects are defined in audio.cpp
@@ -17,20 +17,19 @@ weapon_t::weapon_t() : _needs_ammo(true), _projectile_offset(0, 0, 8) {
     // _init() will be called by derived classes
 }
 
-void weapon_t::_shoot(const vec3& pos, float yaw, float pitch) {
+void weapon_t::_shoot(game_context_t* ctx, const vec3& pos, float yaw, float pitch) {
     if (_needs_ammo) {
         _ammo--;
     }
     audio_play(_sound);
-    _spawn_projectile(pos, yaw, pitch);
+    _spawn_projectile(ctx, pos, yaw, pitch);
 }
 
-void weapon_t::_spawn_projectile(const vec3& pos, float yaw, float pitch) {
-    // Calculate spawn position
+void weapon_t::_spawn_projectile(game_context_t* ctx, const vec3& pos, float yaw, float pitch) {
     vec3 spawn_pos = pos + vec3(0, 12, 0) + vec3_rotate_yaw_pitch(_projectile_offset, yaw, pitch);
-    
-    // Spawn projectile based on type
-    // This will be implemented when we have the projectile classes
+    vec3 velocity = vec3_rotate_yaw_pitch(vec3(0, 0, _projectile_speed), yaw, pitch);
+    projectile_spawn(ctx, _projectile_type, spawn_pos, velocity, yaw - M_PI / 2, -pitch,
+                     ENTITY_GROUP_ENEMY, ctx->entity_player);
     
     // Alternate left/right fire for next projectile (nailgun)
     _projectile_offset.x *= -1;
@@ -49,16 +48,24 @@ void weapon_shotgun_t::_init() {
     _projectile_speed = 10000;
 }
 
-void weapon_shotgun_t::_spawn_projectile(const vec3& pos, float yaw, float pitch) {
-    setTimeout([]() { audio_play(sfx_shotgun_reload); }, 200);
-    setTimeout([]() { audio_play(sfx_shotgun_reload); }, 350);
+// Pellets only lived for 0.1s, they are traced instead of spawned
+const int SHOTGUN_PELLETS = 8;
+const float SHOTGUN_RANGE = 10000 * 0.1f;
+const float SHOTGUN_DAMAGE = 4;
+
+void weapon_shotgun_t::_spawn_projectile(game_context_t* ctx, const vec3& pos, float yaw, float pitch) {
+    setTimeout(ctx, []() { audio_play(sfx_shotgun_reload); }, 200);
+    setTimeout(ctx, []() { audio_play(sfx_shotgun_reload); }, 350);
     
-    // Spawn 8 pellets with spread
-    for (int i = 0; i < 8; i++) {
-        float spread_yaw = yaw + (static_cast<float>(rand()) / RAND_MAX) * 0.08f - 0.04f;
-        float spread_pitch = pitch + (static_cast<float>(rand()) / RAND_MAX) * 0.08f - 0.04f;
-        weapon_t::_spawn_projectile(pos, spread_yaw, spread_pitch);
+    // 8 pellets with spread, traced in one batch
+    vec3 muzzle = pos + vec3(0, 12, 0) + vec3_rotate_yaw_pitch(_projectile_offset, yaw, pitch);
+    hitscan_ray_t rays[SHOTGUN_PELLETS];
+    for (int i = 0; i < SHOTGUN_PELLETS; i++) {
+        float spread_yaw = yaw + random_float(&ctx->random) * 0.08f - 0.04f;
+        float spread_pitch = pitch + random_float(&ctx->random) * 0.08f - 0.04f;
+        rays[i] = {muzzle, vec3_rotate_yaw_pitch(vec3(0, 0, 1), spread_yaw, spread_pitch), SHOTGUN_RANGE};
     }
+    hitscan_fire(ctx, rays, SHOTGUN_PELLETS, ENTITY_GROUP_ENEMY, ctx->entity_player, SHOTGUN_DAMAGE);
 }
 
 weapon_nailgun_t::weapon_nailgun_t() {
@@ -72,6 +79,7 @@ void weapon_nailgun_t::_init() {
     _ammo = 100;
     _reload = 0.09f;
     _projectile_speed = 1300;
+    _projectile_type = PROJECTILE_NAIL;
     _projectile_offset = vec3(6, 0, 8);
 }
 
@@ -86,4 +94,5 @@ void weapon_grenadelauncher_t::_init() {
     _ammo = 10;
     _reload = 0.650f;
     _projectile_speed = 900;
+    _projectile_type = PROJECTILE_GRENADE;
 }
\ No newline at end of file
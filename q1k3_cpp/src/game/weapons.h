@@ -2,15 +2,14 @@
 #define WEAPONS_H
 
 #include "../core/vec3.h"
+#include "projectile.h"
 #include <memory>
 
 // Forward declarations
 class entity_t;
-class entity_projectile_shell_t;
-class entity_projectile_nail_t;
-class entity_projectile_grenade_t;
 class entity_light_t;
 struct model_t;
+struct game_context_t;
 
 // Sound effect declarations
 // These will be loaded from the audio system
@@ -37,20 +36,21 @@ public:
     float _reload;
     int _ammo;
     float _projectile_speed;
+    projectile_type_t _projectile_type;
     
     weapon_t();
     virtual ~weapon_t() = default;
     
     virtual void _init() = 0;
-    virtual void _shoot(const vec3& pos, float yaw, float pitch);
-    virtual void _spawn_projectile(const vec3& pos, float yaw, float pitch);
+    virtual void _shoot(game_context_t* ctx, const vec3& pos, float yaw, float pitch);
+    virtual void _spawn_projectile(game_context_t* ctx, const vec3& pos, float yaw, float pitch);
 };
 
 class weapon_shotgun_t : public weapon_t {
 public:
     weapon_shotgun_t();
     void _init() override;
-    void _spawn_projectile(const vec3& pos, float yaw, float pitch) override;
+    void _spawn_projectile(game_context_t* ctx, const vec3& pos, float yaw, float pitch) override;
 };
 
 class weapon_nailgun_t : public weapon_t {
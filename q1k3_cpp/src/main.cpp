@@ -1,14 +1,30 @@
 #include <iostream>
+#include <string>
+#include <ctime>
 #include "platform/platform.h"
 #include "platform/input.h"
 #include "game/game.h"
 #include "game/audio.h"
 #include "game/ui.h"
+#include "game/demo.h"
 #include "renderer/renderer.h"
 #include "renderer/ttt.h"
 #include "assets/map.h"
+#include "core/jobs.h"
 
-int main(int /*argc*/, char* /*argv*/[]) {
+int main(int argc, char* argv[]) {
+    // --record <file>: record a demo starting with the first click
+    // --play <file>: play a demo back and report the simulation time
+    std::string demo_record_path, demo_play_path;
+    for (int i = 1; i + 1 < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--record") {
+            demo_record_path = argv[++i];
+        } else if (arg == "--play") {
+            demo_play_path = argv[++i];
+        }
+    }
+    
     // Initialize platform
     Platform platform;
     if (!platform.init("Q1K3 C++", 1280, 720)) {
@@ -25,12 +41,17 @@ int main(int /*argc*/, char* /*argv*/[]) {
         return -1;
     }
     
+    // Start worker threads for asset generation and the parallel update
+    // phases
+    jobs_init();
+    
     // Generate textures
     textures_init();
     
     // Initialize audio
     if (!audio_init()) {
         std::cerr << "Failed to initialize audio!" << std::endl;
+        jobs_shutdown();
         return -1;
     }
     
@@ -40,22 +61,35 @@ int main(int /*argc*/, char* /*argv*/[]) {
     // Load assets (copied by CMake to build directory)
     if (!map_load_container("assets/")) {
         std::cerr << "Failed to load maps!" << std::endl;
+        jobs_shutdown();
         return -1;
     }
     
     if (!model_load_container("assets/")) {
         std::cerr << "Failed to load models!" << std::endl;
+        jobs_shutdown();
         return -1;
     }
     
     // Initialize game
-    game_init(0);
+    game_context_t game(&input);
+    game_init(&game, 0);
     
     // Show title screen
     UI::show_title_screen("Q1K3", "CLICK TO START");
     
     // Main game loop
     bool game_started = false;
+    if (!demo_play_path.empty()) {
+        if (!demo_play_start(&game, demo_play_path)) {
+            jobs_shutdown();
+            return -1;
+        }
+        game_started = true;
+        UI::hide_title_screen();
+        audio_play_music();
+    }
+    
     while (platform.is_running()) {
         // Handle events
         SDL_Event event;
@@ -66,6 +100,10 @@ int main(int /*argc*/, char* /*argv*/[]) {
                 // Start game on first click
                 game_started = true;
                 UI::hide_title_screen();
+                if (!demo_record_path.empty()) {
+                    demo_record_start(&game, demo_record_path, game.map_index,
+                                      static_cast<uint32_t>(time(nullptr)));
+                }
                 platform.request_pointer_lock();
                 audio_play_music();
             } else {
@@ -75,10 +113,10 @@ int main(int /*argc*/, char* /*argv*/[]) {
         
         // Update and render game
         float time = platform.get_time();
-        game_run(time);
+        game_run(&game, time);
         
         // Update and render UI
-        UI::update(game_tick);
+        UI::update(game_frame_tick);
         UI::render();
         
         // Swap buffers
@@ -86,7 +124,9 @@ int main(int /*argc*/, char* /*argv*/[]) {
     }
     
     // Cleanup
-    game_cleanup();
+    demo_stop(&game);
+    game_cleanup(&game);
+    jobs_shutdown();
     UI::cleanup();
     audio_cleanup();
     r_cleanup();
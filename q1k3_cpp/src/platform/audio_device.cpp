@@ -0,0 +1,74 @@
+#include "../game/audio.h"
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+// SDL output for the mixer in game/audio.cpp: the device callback pulls
+// from audio_render(), a low priority thread keeps the music ahead of it
+
+static SDL_AudioDeviceID audio_device = 0;
+static SDL_AudioSpec audio_spec;
+static SDL_Thread* audio_music_thread = nullptr;
+static std::atomic<bool> audio_music_running{false};
+
+static void audio_callback(void* /*userdata*/, Uint8* stream, int len) {
+    audio_render(reinterpret_cast<float*>(stream), len / (2 * sizeof(float)));
+}
+
+static int audio_music_main(void* /*data*/) {
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+    while (audio_music_running.load(std::memory_order_relaxed)) {
+        if (!audio_music_fill()) {
+            SDL_Delay(5);
+        }
+    }
+    return 0;
+}
+
+bool audio_init() {
+    // Sounds first, so the callback never sees them half made
+    audio_generate_sounds();
+    
+    SDL_AudioSpec desired;
+    std::memset(&desired, 0, sizeof(desired));
+    desired.freq = AUDIO_SAMPLERATE;
+    desired.format = AUDIO_F32SYS;
+    desired.channels = 2;
+    desired.samples = 2048;
+    desired.callback = audio_callback;
+    
+    audio_device = SDL_OpenAudioDevice(nullptr, 0, &desired, &audio_spec, 0);
+    if (audio_device == 0) {
+        std::cerr << "Failed to open audio device: " << SDL_GetError() << std::endl;
+        audio_free_sounds();
+        return false;
+    }
+    
+    // The music thread starts filling its ring right away, so the music is
+    // ready by the time it is asked for
+    audio_music_running = true;
+    audio_music_thread = SDL_CreateThread(audio_music_main, "music", nullptr);
+    if (!audio_music_thread) {
+        std::cerr << "Failed to start the music thread: " << SDL_GetError() << std::endl;
+        audio_music_running = false;
+    }
+    
+    SDL_PauseAudioDevice(audio_device, 0);
+    return true;
+}
+
+void audio_cleanup() {
+    if (audio_device != 0) {
+        SDL_CloseAudioDevice(audio_device);
+        audio_device = 0;
+    }
+    
+    if (audio_music_thread) {
+        audio_music_running = false;
+        SDL_WaitThread(audio_music_thread, nullptr);
+        audio_music_thread = nullptr;
+    }
+    
+    audio_free_sounds();
+}
@@ -1,5 +1,7 @@
 #include "input.h"
-#include "../game/game.h"
+#ifndef Q1K3_HEADLESS
+#include <SDL2/SDL.h>
+#endif
 
 Input* g_input = nullptr;
 
@@ -10,6 +12,7 @@ Input::Input() : mouse_x(0), mouse_y(0), last_wheel_event(0) {
     g_input = this;
 }
 
+#ifndef Q1K3_HEADLESS
 void Input::handle_event(const SDL_Event& event) {
     switch (event.type) {
         case SDL_KEYDOWN:
@@ -75,13 +78,13 @@ void Input::handle_event(const SDL_Event& event) {
             break;
             
         case SDL_MOUSEWHEEL:
-            if (game_time - last_wheel_event > 0.1f) {
+            if (event.wheel.timestamp / 1000.0f - last_wheel_event > 0.1f) {
                 if (event.wheel.y > 0) {
                     keys[KEY_PREV] = true;
                 } else if (event.wheel.y < 0) {
                     keys[KEY_NEXT] = true;
                 }
-                last_wheel_event = game_time;
+                last_wheel_event = event.wheel.timestamp / 1000.0f;
             }
             break;
             
@@ -107,6 +110,7 @@ void Input::handle_event(const SDL_Event& event) {
             break;
     }
 }
+#endif
 
 void Input::reset_mouse_movement() {
     mouse_x = 0;
@@ -115,4 +119,25 @@ void Input::reset_mouse_movement() {
     // Reset weapon switch keys after processing
     keys[KEY_PREV] = false;
     keys[KEY_NEXT] = false;
+}
+
+input_state_t Input::get_state() const {
+    input_state_t state;
+    state.keys = 0;
+    for (int i = 0; i < 16; i++) {
+        if (keys[i]) {
+            state.keys |= 1 << i;
+        }
+    }
+    state.mouse_x = mouse_x;
+    state.mouse_y = mouse_y;
+    return state;
+}
+
+void Input::set_state(const input_state_t& state) {
+    for (int i = 0; i < 16; i++) {
+        keys[i] = (state.keys >> i) & 1;
+    }
+    mouse_x = state.mouse_x;
+    mouse_y = state.mouse_y;
 }
\ No newline at end of file
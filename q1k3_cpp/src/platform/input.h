@@ -1,7 +1,9 @@
 #ifndef INPUT_H
 #define INPUT_H
 
-#include <SDL2/SDL.h>
+#include <cstdint>
+
+union SDL_Event;
 
 // Key indices matching the JavaScript version
 enum GameKey {
@@ -15,6 +17,18 @@ enum GameKey {
     KEY_JUMP = 9
 };
 
+// Everything the game reads from Input during one tick. Used to record and
+// play back demos.
+struct input_state_t {
+    uint16_t keys;  // bit n = keys[n]
+    float mouse_x, mouse_y;
+    
+    bool operator==(const input_state_t& b) const {
+        return keys == b.keys && mouse_x == b.mouse_x && mouse_y == b.mouse_y;
+    }
+    bool operator!=(const input_state_t& b) const { return !(*this == b); }
+};
+
 class Input {
 private:
     bool keys[16];  // Array to hold key states
@@ -27,6 +41,9 @@ public:
     void handle_event(const SDL_Event& event);
     void reset_mouse_movement();
     
+    input_state_t get_state() const;
+    void set_state(const input_state_t& state);
+    
     bool is_key_down(GameKey key) const { return keys[key]; }
     float get_mouse_x() const { return mouse_x; }
     float get_mouse_y() const { return mouse_y; }
@@ -1,55 +1,75 @@
 #include "renderer.h"
-#include <fstream>
+#include "../assets/asset_file.h"
 #include <iostream>
 #include <cstring>
 
 // Global model storage
 extern std::vector<model_t> r_models;
 extern int r_num_verts;
+extern int r_num_indices;
 
 // Forward declaration
-static void model_init(uint8_t* data, size_t size, float sx = 1, float sy = 1, float sz = 1);
+static bool model_init(const uint8_t* data, size_t size, float sx = 1, float sy = 1, float sz = 1);
 
 bool model_load_container(const std::string& path) {
     // Load all models from container file
-    std::ifstream file(path + "m", std::ios::binary);
-    if (!file.is_open()) {
+    asset_file_t file;
+    if (!asset_file_open(&file, path + "m")) {
         std::cerr << "Failed to open model container: " << path << std::endl;
         return false;
     }
     
-    // Get file size
-    file.seekg(0, std::ios::end);
-    size_t file_size = file.tellg();
-    file.seekg(0, std::ios::beg);
-    
-    // Read entire file
-    std::vector<uint8_t> data(file_size);
-    file.read(reinterpret_cast<char*>(data.data()), file_size);
-    file.close();
-    
     // Parse RMF (Retarded Model Format)
-    size_t i = 0;
-    while (i < data.size()) {
+    asset_reader_t r = asset_reader(&file);
+    while (!asset_done(&r)) {
         // Read header
-        uint8_t num_frames = data[i++];
-        uint8_t num_verts = data[i++];
-        uint8_t num_indices = data[i++];
+        const uint8_t* header = asset_take(&r, 3, "model header");
+        if (!header) {
+            break;
+        }
+        uint8_t num_frames = header[0];
+        uint8_t num_verts = header[1];
+        uint8_t num_indices = header[2];
         
-        // Calculate model size and create model data
+        // Calculate model size; header and model data are contiguous
         size_t model_size = (num_frames * num_verts + num_indices) * 3;
+        if (!asset_take(&r, model_size, "model data")) {
+            break;
+        }
         
         // Parse this model
-        model_init(&data[i - 3], model_size + 3, 1, 1, 1);
-        
-        i += model_size;
+        if (!model_init(header, model_size + 3, 1, 1, 1)) {
+            asset_fail(&r, "invalid model");
+        }
+    }
+    asset_file_close(&file);
+    
+    if (r.failed) {
+        std::cerr << "Failed to load models" << std::endl;
+        return false;
     }
     
-    std::cout << "Loaded " << r_models.size() << " models" << std::endl;
+    int model_verts = 0;
+    int model_indices = 0;
+    for (const auto& model : r_models) {
+        model_verts += model.nv * static_cast<int>(model.f.size());
+        model_indices += model.ni;
+    }
+    if (model_verts > R_MAX_MODEL_VERTS) {
+        std::cerr << "Too many model vertices: " << model_verts << " (at most "
+                  << R_MAX_MODEL_VERTS << ")" << std::endl;
+        return false;
+    }
+    
+    // Submit vertex and index buffer (with the models) to renderer
+    r_submit_buffer();
+    
+    std::cout << "Loaded " << r_models.size() << " models (" << model_verts << " vertices, "
+              << model_indices << " indices)" << std::endl;
     return true;
 }
 
-static void model_init(uint8_t* data, size_t size, float sx, float sy, float sz) {
+static bool model_init(const uint8_t* data, size_t size, float sx, float sy, float sz) {
     model_t model;
     
     // Parse header
@@ -57,8 +77,9 @@ static void model_init(uint8_t* data, size_t size, float sx, float sy, float sz)
     uint8_t num_frames = data[j++];
     uint8_t num_vertices = data[j++];
     uint8_t num_indices = data[j++];
-    
-    model.nv = num_indices * 3; // 3 verts per triangle
+    if (size < 3 + (num_frames * num_vertices + num_indices) * 3u || num_frames == 0) {
+        return false;
+    }
     
     // Load vertices
     std::vector<float> vertices(num_vertices * num_frames * 3);
@@ -89,6 +110,12 @@ static void model_init(uint8_t* data, size_t size, float sx, float sy, float sz)
         indices[i] = index_increment;
         indices[i + 1] = data[j++];
         indices[i + 2] = data[j++];
+        for (int k = 0; k < 3; k++) {
+            if (indices[i + k] >= num_vertices) {
+                std::cerr << "Model vertex index out of range: " << int(indices[i + k]) << std::endl;
+                return false;
+            }
+        }
     }
     
     // UV coordinate factors
@@ -97,42 +124,73 @@ static void model_init(uint8_t* data, size_t size, float sx, float sy, float sz)
     float vf = -1.0f / (max_y - min_y);
     float v = max_y * vf;
     
-    // Process each frame
+    // Shading is flat: the normal of a triangle comes from its last
+    // (provoking) vertex. Each triangle needs a provoking vertex of its
+    // own, so it takes one of its vertices not yet taken, or a copy of one
+    // if all are. Triangles are rotated to put it last, which keeps their
+    // winding.
+    std::vector<int> source;    // RMF vertex of each mesh vertex
+    for (int i = 0; i < num_vertices; i++) {
+        source.push_back(i);
+    }
+    std::vector<bool> taken(num_vertices, false);
+    std::vector<uint16_t> tris(num_indices * 3);
+    for (int i = 0; i < num_indices * 3; i += 3) {
+        // In reverse order (for correct winding)
+        int t[3] = {indices[i + 2], indices[i + 1], indices[i]};
+        int last = -1;
+        for (int k = 2; k >= 0 && last < 0; k--) {
+            if (!taken[t[k]]) {
+                last = k;
+            }
+        }
+        if (last < 0) {
+            last = 2;
+            t[2] = static_cast<int>(source.size());
+            source.push_back(indices[i]);
+            taken.push_back(false);
+        }
+        taken[t[last]] = true;
+        for (int k = 0; k < 3; k++) {
+            tris[i + k] = static_cast<uint16_t>(t[(last + 1 + k) % 3]);
+        }
+    }
+    
+    model.nv = static_cast<int>(source.size());
+    model.ni = num_indices * 3;
+    model.fi = r_num_indices;
+    for (uint16_t index : tris) {
+        r_push_index(index);
+    }
+    
+    // Process each frame: the vertices, then the triangle normals on their
+    // provoking vertices
+    std::vector<vec3> normals;
     for (int frame = 0; frame < num_frames; frame++) {
         model.f.push_back(r_num_verts);
         
         int vertex_offset = frame * num_vertices * 3;
+        auto frame_vert = [&](int index) {
+            int idx = vertex_offset + source[index] * 3;
+            return vec3(vertices[idx], vertices[idx + 1], vertices[idx + 2]);
+        };
         
-        // Process each triangle
+        normals.assign(source.size(), vec3());
         for (int i = 0; i < num_indices * 3; i += 3) {
-            vec3 verts[3];
-            float uvs[3][2];
-            
-            // Get triangle vertices
-            for (int j = 0; j < 3; j++) {
-                int idx = indices[i + j] * 3;
-                verts[j] = vec3(
-                    vertices[vertex_offset + idx],
-                    vertices[vertex_offset + idx + 1],
-                    vertices[vertex_offset + idx + 2]
-                );
-                
-                // Generate UVs based on model space position
-                uvs[j][0] = vertices[idx] * uf + u;
-                uvs[j][1] = vertices[idx + 1] * vf + v;
-            }
-            
-            // Calculate face normal
-            vec3 normal = vec3_face_normal(verts[2], verts[1], verts[0]);
-            
-            // Submit vertices in reverse order (for correct winding)
-            r_push_vert(verts[2], normal, uvs[2][0], uvs[2][1]);
-            r_push_vert(verts[1], normal, uvs[1][0], uvs[1][1]);
-            r_push_vert(verts[0], normal, uvs[0][0], uvs[0][1]);
+            normals[tris[i + 2]] = vec3_face_normal(frame_vert(tris[i]), frame_vert(tris[i + 1]),
+                                                    frame_vert(tris[i + 2]));
+        }
+        
+        for (size_t i = 0; i < source.size(); i++) {
+            // Generate UVs based on model space position
+            int idx = source[i] * 3;
+            r_push_vert(frame_vert(static_cast<int>(i)), normals[i],
+                        vertices[idx] * uf + u, vertices[idx + 1] * vf + v);
         }
     }
     
     r_models.push_back(model);
+    return true;
 }
 
 // Initialize all game models
@@ -171,5 +229,7 @@ void model_init_all() {
 }
 
 void model_init(uint8_t* data, size_t size) {
-    model_init(data, size, 1, 1, 1);
+    if (!model_init(data, size, 1, 1, 1)) {
+        std::cerr << "Invalid model" << std::endl;
+    }
 }
\ No newline at end of file
@@ -11,12 +11,18 @@ float r_camera_yaw = 0;
 float r_camera_pitch = 0;
 
 // Renderer state
-static GLuint shader_program;
-static GLuint vao, vbo;
+static GLuint shader_program, model_program;
+static GLuint vao, vbo, ibo;
+static GLuint model_vao, model_buffer, vertex_tex, instance_buffer, instance_tex;
 static vertex_t* r_buffer;
 int r_num_verts = 0;
+static int r_model_first_vert = 0;  // models come after the map blocks
+static uint16_t* r_index_buffer;
+int r_num_indices = 0;
 static std::vector<light_t> r_lights;
 static std::vector<draw_call_t> r_draw_calls;
+static std::vector<model_call_t> r_model_calls;
+static std::vector<float> r_instance_data;
 static std::vector<texture_t> r_textures;
 std::vector<model_t> r_models;
 
@@ -26,27 +32,26 @@ static GLint r_u_lights;
 static GLint r_u_mouse;
 static GLint r_u_pos;
 static GLint r_u_rotation;
-static GLint r_u_frame_mix;
 static GLint r_u_texture;
 
-// Vertex shader source (ported from JS)
-const char* R_SOURCE_VS = R"(
-#version 330 core
+static GLint r_u_model_camera;
+static GLint r_u_model_lights;
+static GLint r_u_model_mouse;
+static GLint r_u_model_texture;
+static GLint r_u_model_vertices;
+static GLint r_u_model_instances;
+static GLint r_u_model_instance_base;
 
-layout(location = 0) in vec3 p;    // position
-layout(location = 1) in vec2 t;    // texture coord
-layout(location = 2) in vec3 n;    // normal
-layout(location = 3) in vec3 p2;   // mix position
-layout(location = 4) in vec3 n2;   // mix normal
+// Vertex shader code shared by both programs (ported from JS)
+const char* R_SOURCE_VS_COMMON = R"(
+#version 330 core
 
-out vec3 vp, vn;
+out vec3 vp;
+flat out vec3 vn;   // from the last vertex of each triangle
 out vec2 vt;
 
 uniform vec4 c;      // Camera position (xyz) and aspect ratio (w)
-uniform vec3 mp;     // Model position
-uniform vec2 mr;     // Model rotation (yaw, pitch)
 uniform vec2 m;      // Mouse rotation (yaw, pitch)
-uniform float f;     // Blend factor
 
 mat4 rx(float r) {
     return mat4(
@@ -75,12 +80,12 @@ mat4 rz(float r) {
     );
 }
 
-void main() {
+void emit(vec3 p, vec3 n, vec2 t, vec3 mp, vec2 mr) {
     mat4 mry = ry(mr.x);
     mat4 mrz = rz(mr.y);
     
-    vp = (mry * mrz * vec4(mix(p, p2, f), 1.0)).xyz + mp;
-    vn = (mry * mrz * vec4(mix(n, n2, f), 1.0)).xyz;
+    vp = (mry * mrz * vec4(p, 1.0)).xyz + mp;
+    vn = (mry * mrz * vec4(n, 1.0)).xyz;
     vt = t;
     
     mat4 projection = mat4(
@@ -94,11 +99,50 @@ void main() {
 }
 )";
 
+// Static geometry (map blocks), one draw per call
+const char* R_SOURCE_VS = R"(
+layout(location = 0) in vec3 p;    // position
+layout(location = 1) in vec2 t;    // texture coord
+layout(location = 2) in vec3 n;    // normal
+
+uniform vec3 mp;     // Model position
+uniform vec2 mr;     // Model rotation (yaw, pitch)
+
+void main() {
+    emit(p, n, t, mp, mr);
+}
+)";
+
+// Models, instanced: their vertices are read from a texture buffer, two
+// texels per vertex_t. An instance is two texels as well; which frames it blends
+// is part of it, so all instances of a model and texture are one draw
+// whatever their animation state.
+const char* R_SOURCE_VS_MODEL = R"(
+uniform samplerBuffer v;    // (x, y, z, u), (v, nx, ny, nz)
+uniform samplerBuffer i;    // (x, y, z, yaw), (pitch, mix, frame1, frame2)
+uniform int ib;             // First instance of this draw
+
+void main() {
+    int instance = (ib + gl_InstanceID) * 2;
+    vec4 i0 = texelFetch(i, instance);
+    vec4 i1 = texelFetch(i, instance + 1);
+    
+    int v1 = (int(i1.z) + gl_VertexID) * 2;
+    int v2 = (int(i1.w) + gl_VertexID) * 2;
+    vec4 a0 = texelFetch(v, v1), a1 = texelFetch(v, v1 + 1);
+    vec4 b0 = texelFetch(v, v2), b1 = texelFetch(v, v2 + 1);
+    
+    emit(mix(a0.xyz, b0.xyz, i1.y), mix(a1.yzw, b1.yzw, i1.y), vec2(a0.w, a1.x),
+         i0.xyz, vec2(i0.w, i1.x));
+}
+)";
+
 // Fragment shader source (ported from JS)
 const char* R_SOURCE_FS = R"(
 #version 330 core
 
-in vec3 vp, vn;
+in vec3 vp;
+flat in vec3 vn;
 in vec2 vt;
 
 out vec4 FragColor;
@@ -126,9 +170,9 @@ void main() {
 }
 )";
 
-static GLuint compile_shader(GLenum type, const char* source) {
+static GLuint compile_shader(GLenum type, const char* const* sources, int count) {
     GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, nullptr);
+    glShaderSource(shader, count, sources, nullptr);
     glCompileShader(shader);
     
     // Check compilation
@@ -143,6 +187,32 @@ static GLuint compile_shader(GLenum type, const char* source) {
     return shader;
 }
 
+static GLuint link_program(const char* vs_source) {
+    const char* vs_sources[] = {R_SOURCE_VS_COMMON, vs_source};
+    GLuint vs = compile_shader(GL_VERTEX_SHADER, vs_sources, 2);
+    GLuint fs = compile_shader(GL_FRAGMENT_SHADER, &R_SOURCE_FS, 1);
+    
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    
+    // Check linking
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char info[512];
+        glGetProgramInfoLog(program, 512, nullptr, info);
+        std::cerr << "Shader linking failed: " << info << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    
+    return program;
+}
+
 bool r_init() {
     // Initialize GLEW
     glewExperimental = GL_TRUE;
@@ -151,32 +221,16 @@ bool r_init() {
         return false;
     }
     
-    // Allocate vertex buffer
-    r_buffer = new vertex_t[R_MAX_VERTS];
-    
     // Create and compile shaders
-    GLuint vs = compile_shader(GL_VERTEX_SHADER, R_SOURCE_VS);
-    GLuint fs = compile_shader(GL_FRAGMENT_SHADER, R_SOURCE_FS);
-    
-    shader_program = glCreateProgram();
-    glAttachShader(shader_program, vs);
-    glAttachShader(shader_program, fs);
-    glLinkProgram(shader_program);
-    
-    // Check linking
-    GLint success;
-    glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
-    if (!success) {
-        char info[512];
-        glGetProgramInfoLog(shader_program, 512, nullptr, info);
-        std::cerr << "Shader linking failed: " << info << std::endl;
+    shader_program = link_program(R_SOURCE_VS);
+    model_program = link_program(R_SOURCE_VS_MODEL);
+    if (!shader_program || !model_program) {
         return false;
     }
     
-    glDeleteShader(vs);
-    glDeleteShader(fs);
-    
-    glUseProgram(shader_program);
+    // Allocate vertex and index buffers
+    r_buffer = new vertex_t[R_MAX_VERTS];
+    r_index_buffer = new uint16_t[R_MAX_INDICES];
     
     // Get uniform locations
     r_u_camera = glGetUniformLocation(shader_program, "c");
@@ -184,16 +238,26 @@ bool r_init() {
     r_u_mouse = glGetUniformLocation(shader_program, "m");
     r_u_pos = glGetUniformLocation(shader_program, "mp");
     r_u_rotation = glGetUniformLocation(shader_program, "mr");
-    r_u_frame_mix = glGetUniformLocation(shader_program, "f");
     r_u_texture = glGetUniformLocation(shader_program, "s");
     
-    // Create VAO and VBO
+    r_u_model_camera = glGetUniformLocation(model_program, "c");
+    r_u_model_lights = glGetUniformLocation(model_program, "l");
+    r_u_model_mouse = glGetUniformLocation(model_program, "m");
+    r_u_model_texture = glGetUniformLocation(model_program, "s");
+    r_u_model_vertices = glGetUniformLocation(model_program, "v");
+    r_u_model_instances = glGetUniformLocation(model_program, "i");
+    r_u_model_instance_base = glGetUniformLocation(model_program, "ib");
+    
+    // Create VAO, VBO and the index buffer (part of the VAO's state)
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ibo);
     
     glBindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, R_MAX_VERTS * sizeof(vertex_t), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, R_MAX_INDICES * sizeof(uint16_t), nullptr, GL_DYNAMIC_DRAW);
     
     // Setup vertex attributes
     // Position
@@ -208,13 +272,35 @@ bool r_init() {
     glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
     glEnableVertexAttribArray(2);
     
-    // Mix position (p2) - will be offset later for animated models
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(vertex_t), (void*)offsetof(vertex_t, pos));
-    glEnableVertexAttribArray(3);
-    
-    // Mix normal (n2) - will be offset later for animated models
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
-    glEnableVertexAttribArray(4);
+    // Models have no vertex attributes, only the index buffer
+    glGenVertexArrays(1, &model_vao);
+    glBindVertexArray(model_vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    
+    // Model vertices and instances as RGBA32F texels on units 1 and 2. The
+    // model vertices get a buffer of their own: a texture buffer over all
+    // of vbo could exceed GL_MAX_TEXTURE_BUFFER_SIZE, and glTexBufferRange()
+    // needs GL 4.3.
+    glGenBuffers(1, &model_buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, model_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, R_MAX_MODEL_VERTS * sizeof(vertex_t), nullptr, GL_STATIC_DRAW);
+    glGenTextures(1, &vertex_tex);
+    glBindTexture(GL_TEXTURE_BUFFER, vertex_tex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, model_buffer);
+    
+    glGenBuffers(1, &instance_buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, instance_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, 0, nullptr, GL_STREAM_DRAW);
+    glGenTextures(1, &instance_tex);
+    glBindTexture(GL_TEXTURE_BUFFER, instance_tex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instance_buffer);
+    
+    glUseProgram(model_program);
+    glUniform1i(r_u_model_texture, 0);
+    glUniform1i(r_u_model_vertices, 1);
+    glUniform1i(r_u_model_instances, 2);
+    glUseProgram(shader_program);
+    glUniform1i(r_u_texture, 0);
     
     // OpenGL state
     glEnable(GL_DEPTH_TEST);
@@ -222,6 +308,7 @@ bool r_init() {
     glCullFace(GL_BACK);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glProvokingVertex(GL_LAST_VERTEX_CONVENTION);
     
     // Set viewport
     glViewport(0, 0, g_platform->get_width(), g_platform->get_height());
@@ -231,9 +318,17 @@ bool r_init() {
 
 void r_cleanup() {
     delete[] r_buffer;
+    delete[] r_index_buffer;
     glDeleteProgram(shader_program);
+    glDeleteProgram(model_program);
     glDeleteVertexArrays(1, &vao);
+    glDeleteVertexArrays(1, &model_vao);
     glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ibo);
+    glDeleteBuffers(1, &model_buffer);
+    glDeleteBuffers(1, &instance_buffer);
+    glDeleteTextures(1, &vertex_tex);
+    glDeleteTextures(1, &instance_tex);
     
     for (auto& tex : r_textures) {
         glDeleteTextures(1, &tex.id);
@@ -246,6 +341,7 @@ void r_prepare_frame(float r, float g, float b) {
     
     r_lights.clear();
     r_draw_calls.clear();
+    r_model_calls.clear();
 }
 
 void r_end_frame() {
@@ -262,11 +358,11 @@ void r_end_frame() {
         light_buffer[i * 6 + 5] = r_lights[i].color.z;
     }
     
+    float aspect = static_cast<float>(g_platform->get_width()) / g_platform->get_height();
+    
+    // Static geometry
     glUseProgram(shader_program);
     glBindVertexArray(vao);
-    
-    // Set uniforms
-    float aspect = static_cast<float>(g_platform->get_width()) / g_platform->get_height();
     glUniform4f(r_u_camera, r_camera.x, r_camera.y, r_camera.z, aspect);
     glUniform2f(r_u_mouse, r_camera_yaw, r_camera_pitch);
     glUniform3fv(r_u_lights, R_MAX_LIGHTS * 2, light_buffer);
@@ -277,7 +373,6 @@ void r_end_frame() {
     
     // Draw all calls
     int last_texture = -1;
-    int vertex_offset = 0;
     
     for (const auto& call : r_draw_calls) {
         // Bind texture if changed
@@ -285,30 +380,82 @@ void r_end_frame() {
             last_texture = call.texture;
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_2D, r_textures[call.texture].id);
-            glUniform1i(r_u_texture, 0);
         }
         
         // Set model uniforms
         glUniform3f(r_u_pos, call.pos.x, call.pos.y, call.pos.z);
         glUniform2f(r_u_rotation, call.yaw, call.pitch);
-        glUniform1f(r_u_frame_mix, call.mix);
         
-        // Update vertex attribute pointers for animation if needed
-        if (vertex_offset != (call.offset2 - call.offset1)) {
-            vertex_offset = call.offset2 - call.offset1;
-            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(vertex_t),
-                (void*)(vertex_offset * sizeof(vertex_t) + offsetof(vertex_t, pos)));
-            glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(vertex_t),
-                (void*)(vertex_offset * sizeof(vertex_t) + offsetof(vertex_t, normal)));
+        glDrawArrays(GL_TRIANGLES, call.offset, call.num_verts);
+    }
+    
+    if (r_model_calls.empty()) {
+        return;
+    }
+    
+    // Models: instances of the same model and texture are adjacent after
+    // sorting, each run is one instanced draw
+    std::sort(r_model_calls.begin(), r_model_calls.end(),
+        [](const model_call_t& a, const model_call_t& b) {
+            return a.texture != b.texture ? a.texture < b.texture : a.model->fi < b.model->fi;
+        });
+    
+    r_instance_data.resize(r_model_calls.size() * 8);
+    float* instance = r_instance_data.data();
+    for (const auto& call : r_model_calls) {
+        *instance++ = call.pos.x;
+        *instance++ = call.pos.y;
+        *instance++ = call.pos.z;
+        *instance++ = call.yaw;
+        *instance++ = call.pitch;
+        *instance++ = call.mix;
+        *instance++ = static_cast<float>(call.offset1);
+        *instance++ = static_cast<float>(call.offset2);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, instance_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, r_instance_data.size() * sizeof(float),
+                 r_instance_data.data(), GL_STREAM_DRAW);
+    
+    glUseProgram(model_program);
+    glBindVertexArray(model_vao);
+    glUniform4f(r_u_model_camera, r_camera.x, r_camera.y, r_camera.z, aspect);
+    glUniform2f(r_u_model_mouse, r_camera_yaw, r_camera_pitch);
+    glUniform3fv(r_u_model_lights, R_MAX_LIGHTS * 2, light_buffer);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, vertex_tex);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_BUFFER, instance_tex);
+    glActiveTexture(GL_TEXTURE0);
+    
+    last_texture = -1;
+    for (size_t first = 0, end; first < r_model_calls.size(); first = end) {
+        const model_call_t& call = r_model_calls[first];
+        for (end = first + 1; end < r_model_calls.size(); end++) {
+            if (r_model_calls[end].texture != call.texture || r_model_calls[end].model != call.model) {
+                break;
+            }
         }
         
-        glDrawArrays(GL_TRIANGLES, call.offset1, call.num_verts);
+        if (last_texture != call.texture) {
+            last_texture = call.texture;
+            glBindTexture(GL_TEXTURE_2D, r_textures[call.texture].id);
+        }
+        
+        glUniform1i(r_u_model_instance_base, static_cast<int>(first));
+        glDrawElementsInstanced(GL_TRIANGLES, call.model->ni, GL_UNSIGNED_SHORT,
+                                (void*)(call.model->fi * sizeof(uint16_t)),
+                                static_cast<int>(end - first));
     }
 }
 
-void r_draw(const vec3& pos, float yaw, float pitch, int texture,
-            int frame1, int frame2, float mix, int num_verts) {
-    r_draw_calls.push_back({pos, yaw, pitch, texture, frame1, frame2, mix, num_verts});
+void r_draw(const vec3& pos, float yaw, float pitch, int texture, int offset, int num_verts) {
+    r_draw_calls.push_back({pos, yaw, pitch, texture, offset, num_verts});
+}
+
+void r_draw_model(const vec3& pos, float yaw, float pitch, int texture,
+                  const model_t* model, int frame1, int frame2, float mix) {
+    r_model_calls.push_back({model, texture, pos, yaw, pitch, model->f[frame1] - r_model_first_vert,
+                             model->f[frame2] - r_model_first_vert, mix});
 }
 
 void r_push_light(const vec3& pos, float intensity, float r, float g, float b) {
@@ -324,6 +471,15 @@ void r_push_light(const vec3& pos, float intensity, float r, float g, float b) {
 void r_submit_buffer() {
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferSubData(GL_ARRAY_BUFFER, 0, r_num_verts * sizeof(vertex_t), r_buffer);
+    glBindVertexArray(vao);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, r_num_indices * sizeof(uint16_t), r_index_buffer);
+    
+    // The model vertices are the end of the buffer (model_load_container
+    // checked that they fit)
+    r_model_first_vert = r_models.empty() ? r_num_verts : r_models.front().f[0];
+    int model_verts = std::min(r_num_verts - r_model_first_vert, R_MAX_MODEL_VERTS);
+    glBindBuffer(GL_TEXTURE_BUFFER, model_buffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, model_verts * sizeof(vertex_t), r_buffer + r_model_first_vert);
 }
 
 int r_push_vert(const vec3& pos, const vec3& normal, float u, float v) {
@@ -333,6 +489,13 @@ int r_push_vert(const vec3& pos, const vec3& normal, float u, float v) {
     return r_num_verts++;
 }
 
+int r_push_index(uint16_t index) {
+    if (r_num_indices >= R_MAX_INDICES) return r_num_indices;
+    
+    r_index_buffer[r_num_indices] = index;
+    return r_num_indices++;
+}
+
 void r_push_quad(const vec3& v0, const vec3& v1, const vec3& v2, const vec3& v3, float u, float v) {
     vec3 n = vec3_face_normal(v0, v1, v2);
     r_push_vert(v0, n, u, 0);
@@ -371,7 +534,7 @@ int r_push_block(float x, float y, float z, float sx, float sy, float sz, int te
     return index;
 }
 
-void r_create_texture(GLubyte* data, int width, int height) {
+void r_create_texture(const GLubyte* data, int width, int height) {
     texture_t tex;
     tex.width = width;
     tex.height = height;
@@ -4,10 +4,21 @@
 #include "../core/vec3.h"
 #include <vector>
 #include <string>
+#include <cstdint>
+#ifdef Q1K3_HEADLESS
+// The headless simulation links a null renderer and has no GL headers
+typedef unsigned int GLuint;
+typedef unsigned char GLubyte;
+#else
 #include <GL/glew.h>
+#endif
 
 // Constants
 const int R_MAX_VERTS = 1024 * 64;
+const int R_MAX_INDICES = 1024 * 64;
+// Model vertices are read from a texture buffer, two texels each; GL 3.3
+// only guarantees 64k texels
+const int R_MAX_MODEL_VERTS = 1024 * 32;
 const int R_MAX_LIGHTS = 32;
 
 // Global renderer variables
@@ -22,14 +33,27 @@ struct vertex_t {
     vec3 normal;
 };
 
+// The model shader reads vertices as two RGBA32F texels
+static_assert(sizeof(vertex_t) == 8 * sizeof(float), "vertex_t must be 8 floats");
+
 // Draw call structure
 struct draw_call_t {
     vec3 pos;
     float yaw, pitch;
     int texture;
+    int offset;
+    int num_verts;
+};
+
+// Model instance, blending between two frames
+struct model_t;
+struct model_call_t {
+    const model_t* model;
+    int texture;
+    vec3 pos;
+    float yaw, pitch;
     int offset1, offset2;
     float mix;
-    int num_verts;
 };
 
 // Light structure
@@ -38,10 +62,13 @@ struct light_t {
     vec3 color;  // color * intensity
 };
 
-// Model structure
+// Model structure. All frames share one list of triangles in the index
+// buffer; indices are relative to the frame's first vertex.
 struct model_t {
     std::vector<int> f;  // Frame offsets in vertex buffer
     int nv;              // Number of vertices per frame
+    int fi;              // First index in index buffer
+    int ni;              // Number of indices
 };
 
 // Texture structure
@@ -55,18 +82,20 @@ bool r_init();
 void r_cleanup();
 void r_prepare_frame(float r, float g, float b);
 void r_end_frame();
-void r_draw(const vec3& pos, float yaw, float pitch, int texture,
-            int frame1, int frame2, float mix, int num_verts);
+void r_draw(const vec3& pos, float yaw, float pitch, int texture, int offset, int num_verts);
+void r_draw_model(const vec3& pos, float yaw, float pitch, int texture,
+                  const model_t* model, int frame1, int frame2, float mix);
 void r_push_light(const vec3& pos, float intensity, float r, float g, float b);
 void r_submit_buffer();
 
 // Geometry building
 int r_push_vert(const vec3& pos, const vec3& normal, float u, float v);
+int r_push_index(uint16_t index);
 void r_push_quad(const vec3& v0, const vec3& v1, const vec3& v2, const vec3& v3, float u, float v);
 int r_push_block(float x, float y, float z, float sx, float sy, float sz, int texture);
 
 // Texture functions
-void r_create_texture(GLubyte* data, int width, int height);
+void r_create_texture(const GLubyte* data, int width, int height);
 
 // Model loading
 bool model_load_container(const std::string& path);
@@ -1,3 +1,27 @@
 #include "renderer.h"
+#include "ttt.h"
 
-// Texture stub implementation
\ No newline at end of file
+#ifdef Q1K3_BAKED_TEXTURES
+// Generated by q1k3_ttt_bake at build time: the pixels of all textures as
+// read-only data in the executable
+#include "baked_textures.h"
+
+void textures_init() {
+    for (int i = 0; i < ttt_baked_count; i++) {
+        r_create_texture(ttt_baked[i].pixels, ttt_baked[i].width, ttt_baked[i].height);
+    }
+}
+#else
+// Include texture data from JS
+#include "textures.h"
+
+void textures_init() {
+    // Generate all textures
+    auto generated_textures = ttt_generate(texture_data);
+    
+    // Create OpenGL textures
+    for (const auto& tex : generated_textures) {
+        r_create_texture(reinterpret_cast<const GLubyte*>(tex.pixels.data()), tex.width, tex.height);
+    }
+}
+#endif
@@ -1,158 +1,259 @@
 #include "ttt.h"
-#include "renderer.h"
+#include "../core/random.h"
+#include "../core/jobs.h"
 #include <cstring>
 #include <cmath>
-#include <cstdlib>
 #include <algorithm>
 
+// Textures are drawn like the original draws them on a 2d canvas: every
+// operation is composited over what is there ("source-over"). Pixels are
+// packed RGBA32 in GL byte order.
+
+// Number of arguments of each operation
+static const int TTT_OP_ARGS[] = {7, 9, 2, 6, 6};
+static const int TTT_NUM_OPS = sizeof(TTT_OP_ARGS) / sizeof(TTT_OP_ARGS[0]);
+
+// A color to draw with: 8 bit RGB and alpha as 0..1
+struct ttt_color_t {
+    float r, g, b, a;
+};
+
 // Helper to convert 16-bit color to RGBA components
-static void rgba_from_2byte(int color, GLubyte& r, GLubyte& g, GLubyte& b, GLubyte& a) {
-    r = ((color >> 12) & 15) * 17;
-    g = ((color >> 8) & 15) * 17;  
-    b = ((color >> 4) & 15) * 17;
-    a = (color & 15) * 17;
+static ttt_color_t rgba_from_2byte(int color) {
+    return {
+        static_cast<float>(((color >> 12) & 15) * 17),
+        static_cast<float>(((color >> 8) & 15) * 17),
+        static_cast<float>(((color >> 4) & 15) * 17),
+        (color & 15) / 15.0f
+    };
 }
 
-// Fill rectangle with color (including emboss effect)
-static void fill_rect(GLubyte* data, int width, int height, 
-                     int x, int y, int w, int h, 
-                     int top_color, int bottom_color, int fill_color) {
-    
-    GLubyte tr, tg, tb, ta;
-    GLubyte br, bg, bb, ba;
-    GLubyte fr, fg, fb, fa;
-    
-    rgba_from_2byte(top_color, tr, tg, tb, ta);
-    rgba_from_2byte(bottom_color, br, bg, bb, ba);
-    rgba_from_2byte(fill_color, fr, fg, fb, fa);
-    
-    // Draw with emboss effect (top-left highlight, bottom-right shadow)
-    for (int py = std::max(0, y); py < std::min(height, y + h); py++) {
-        for (int px = std::max(0, x); px < std::min(width, x + w); px++) {
-            int idx = (py * width + px) * 4;
-            
-            // Main fill
-            if (px >= x && px < x + w && py >= y && py < y + h) {
-                data[idx] = fr;
-                data[idx + 1] = fg;
-                data[idx + 2] = fb;
-                data[idx + 3] = fa;
-            }
-            
-            // Top/left highlight
-            if ((px == x - 1 || py == y - 1) && px >= 0 && py >= 0) {
-                data[idx] = tr;
-                data[idx + 1] = tg;
-                data[idx + 2] = tb;
-                data[idx + 3] = ta;
-            }
-            
-            // Bottom/right shadow
-            if ((px == x + w || py == y + h) && px < width && py < height) {
-                data[idx] = br;
-                data[idx + 1] = bg;
-                data[idx + 2] = bb;
-                data[idx + 3] = ba;
-            }
+static uint32_t ttt_pack(float r, float g, float b, float a) {
+    uint8_t bytes[4] = {
+        static_cast<uint8_t>(r + 0.5f),
+        static_cast<uint8_t>(g + 0.5f),
+        static_cast<uint8_t>(b + 0.5f),
+        static_cast<uint8_t>(a * 255.0f + 0.5f)
+    };
+    uint32_t pixel;
+    std::memcpy(&pixel, bytes, 4);
+    return pixel;
+}
+
+// Non-premultiplied source-over of one color onto one pixel
+static uint32_t ttt_over(uint32_t dst, const ttt_color_t& src) {
+    uint8_t d[4];
+    std::memcpy(d, &dst, 4);
+    float da = d[3] / 255.0f * (1.0f - src.a);
+    float a = src.a + da;
+    if (a <= 0) {
+        return 0;
+    }
+    return ttt_pack((src.r * src.a + d[0] * da) / a,
+                    (src.g * src.a + d[1] * da) / a,
+                    (src.b * src.a + d[2] * da) / a, a);
+}
+
+// One color over a run of pixels. Opaque colors are plain writes.
+static void ttt_span(uint32_t* dst, int n, const ttt_color_t& color) {
+    if (color.a >= 1.0f) {
+        std::fill_n(dst, n, ttt_pack(color.r, color.g, color.b, 1.0f));
+    } else if (color.a > 0) {
+        for (int i = 0; i < n; i++) {
+            dst[i] = ttt_over(dst[i], color);
         }
     }
 }
 
-std::vector<ttt_texture_t> ttt_generate(const std::vector<std::vector<int>>& texture_data) {
-    std::vector<ttt_texture_t> textures;
+static void ttt_rect(ttt_texture_t& tex, int x, int y, int w, int h, const ttt_color_t& color) {
+    int x0 = std::max(0, x);
+    int x1 = std::min(tex.width, x + w);
+    int y0 = std::max(0, y);
+    int y1 = std::min(tex.height, y + h);
+    if (x0 >= x1 || color.a <= 0) {
+        return;
+    }
+    for (int py = y0; py < y1; py++) {
+        ttt_span(&tex.pixels[py * tex.width + x0], x1 - x0, color);
+    }
+}
+
+// Emboss: the top color is drawn one pixel up and left, the bottom color
+// one pixel down and right, the fill over both
+static void fill_rect(ttt_texture_t& tex, int x, int y, int w, int h,
+                      int top_color, int bottom_color, int fill_color) {
+    ttt_rect(tex, x - 1, y - 1, w, h, rgba_from_2byte(top_color));
+    ttt_rect(tex, x + 1, y + 1, w, h, rgba_from_2byte(bottom_color));
+    ttt_rect(tex, x, y, w, h, rgba_from_2byte(fill_color));
+}
+
+// Another texture scaled into x, y, w, h, with its alpha scaled by alpha.
+// Sampled nearest neighbour, like the textures are drawn in game.
+static void ttt_draw_texture(ttt_texture_t& tex, const ttt_texture_t& src,
+                             int x, int y, int w, int h, float alpha) {
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+    for (int py = std::max(0, y); py < std::min(tex.height, y + h); py++) {
+        const uint32_t* src_row = &src.pixels[((py - y) * src.height / h) * src.width];
+        uint32_t* dst_row = &tex.pixels[py * tex.width];
+        for (int px = std::max(0, x); px < std::min(tex.width, x + w); px++) {
+            uint8_t s[4];
+            std::memcpy(s, &src_row[(px - x) * src.width / w], 4);
+            dst_row[px] = ttt_over(dst_row[px], {
+                static_cast<float>(s[0]), static_cast<float>(s[1]), static_cast<float>(s[2]),
+                s[3] / 255.0f * alpha
+            });
+        }
+    }
+}
+
+// The textures drawn by the op 4s of a texture, in order
+static std::vector<int> ttt_references(const std::vector<int>& d) {
+    std::vector<int> refs;
+    for (size_t i = 3; i < d.size();) {
+        int op = d[i++];
+        if (op < 0 || op >= TTT_NUM_OPS) {
+            break;
+        }
+        if (op == 4 && i < d.size()) {
+            refs.push_back(d[i]);
+        }
+        i += TTT_OP_ARGS[op];
+    }
+    return refs;
+}
+
+static void ttt_generate_one(const std::vector<int>& d, int index, ttt_texture_t& tex,
+                             const std::vector<ttt_texture_t>& textures, const std::vector<int>& level) {
+    size_t i = 0;
+    tex.width = d[i++];
+    tex.height = d[i++];
+    tex.pixels.assign(tex.width * tex.height, 0);
     
-    for (const auto& d : texture_data) {
-        int i = 0;
-        int width = d[i++];
-        int height = d[i++];
-        
-        ttt_texture_t tex;
-        tex.width = width;
-        tex.height = height;
-        tex.data = new GLubyte[width * height * 4];
+    // Noise of each texture comes from its own stream, so it doesn't
+    // depend on what was generated before
+    random_t random;
+    random_seed(&random, 0, index);
+    
+    // Fill with background color
+    fill_rect(tex, 0, 0, tex.width, tex.height, 0, 0, d[i++]);
+    
+    // Process all operations for this texture
+    while (i < d.size()) {
+        int op = d[i++];
+        if (op < 0 || op >= TTT_NUM_OPS) {
+            break;
+        }
         
-        // Fill with background color
-        int bg_color = d[i++];
-        fill_rect(tex.data, width, height, 0, 0, width, height, 0, 0, bg_color);
+        // Missing trailing arguments read as 0
+        int a[9] = {};
+        for (int k = 0; k < TTT_OP_ARGS[op] && i < d.size(); k++) {
+            a[k] = d[i++];
+        }
         
-        // Process all operations for this texture
-        while (i < d.size()) {
-            int op = d[i++];
+        switch (op) {
+            case 0: // Rectangle: x, y, w, h, top, bottom, fill
+                fill_rect(tex, a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+                break;
             
-            switch (op) {
-                case 0: { // Rectangle
-                    int x = d[i++];
-                    int y = d[i++];
-                    int w = d[i++];
-                    int h = d[i++];
-                    int top = d[i++];
-                    int bottom = d[i++];
-                    int fill = d[i++];
-                    fill_rect(tex.data, width, height, x, y, w, h, top, bottom, fill);
+            case 1: // Multiple rectangles: start x & y, w, h, inc x & y, top, bottom, fill
+                if (a[4] <= 0 || a[5] <= 0) {
                     break;
                 }
-                
-                case 1: { // Multiple rectangles
-                    int sx = d[i++];
-                    int sy = d[i++];
-                    int w = d[i++];
-                    int h = d[i++];
-                    int inc_x = d[i++];
-                    int inc_y = d[i++];
-                    int top = d[i++];
-                    int bottom = d[i++];
-                    int fill = d[i++];
-                    
-                    for (int x = sx; x < width; x += inc_x) {
-                        for (int y = sy; y < height; y += inc_y) {
-                            fill_rect(tex.data, width, height, x, y, w, h, top, bottom, fill);
-                        }
+                for (int x = a[0]; x < tex.width; x += a[4]) {
+                    for (int y = a[1]; y < tex.height; y += a[5]) {
+                        fill_rect(tex, x, y, a[2], a[3], a[6], a[7], a[8]);
                     }
+                }
+                break;
+            
+            case 2: { // Random noise: color, size. The alpha is random
+                      // between 0 and that of the color.
+                int color = a[0];
+                int size = a[1];
+                if (size <= 0) {
                     break;
                 }
-                
-                case 2: { // Random noise
-                    int color = d[i++];
-                    int size = d[i++];
-                    
-                    for (int x = 0; x < width; x += size) {
-                        for (int y = 0; y < height; y += size) {
-                            int noise_color = (color & 0xfff0) + 
-                                            static_cast<int>(static_cast<float>(rand()) / RAND_MAX * (color & 15));
-                            fill_rect(tex.data, width, height, x, y, size, size, 0, 0, noise_color);
-                        }
+                for (int x = 0; x < tex.width; x += size) {
+                    for (int y = 0; y < tex.height; y += size) {
+                        int noise_color = (color & 0xfff0) +
+                            static_cast<int>(random_float(&random) * (color & 15));
+                        fill_rect(tex, x, y, size, size, 0, 0, noise_color);
                     }
-                    break;
                 }
-                
-                case 3: { // Text (skip for now - would need font rendering)
-                    i += 6; // Skip parameters
-                    break;
+                break;
+            }
+            
+            case 3: // Text (skip for now - would need font rendering)
+                break;
+            
+            case 4: // Draw another texture: index, x, y, w, h, alpha. Only
+                    // ones from an earlier wave are ready.
+                if (a[0] >= 0 && a[0] < static_cast<int>(textures.size()) && level[a[0]] < level[index]) {
+                    ttt_draw_texture(tex, textures[a[0]], a[1], a[2], a[3], a[4], a[5] / 15.0f);
                 }
-                
-                case 4: { // Draw previous texture (skip for now - complex)
-                    i += 6; // Skip parameters
-                    break;
+                break;
+        }
+    }
+}
+
+std::vector<ttt_texture_t> ttt_generate(const std::vector<std::vector<int>>& texture_data) {
+    const int count = static_cast<int>(texture_data.size());
+    
+    // Textures are generated in waves: a texture drawing others comes in
+    // the wave after the last of them. Textures drawing each other in a
+    // loop are left without the ones they can't have.
+    std::vector<std::vector<int>> refs(count);
+    for (int t = 0; t < count; t++) {
+        refs[t] = ttt_references(texture_data[t]);
+    }
+    std::vector<int> level(count, -1);
+    int num_levels = 0;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int t = 0; t < count; t++) {
+            if (level[t] >= 0) {
+                continue;
+            }
+            int l = 0;
+            for (int r : refs[t]) {
+                if (r >= 0 && r < count) {
+                    l = level[r] < 0 ? -1 : std::max(l, level[r] + 1);
+                    if (l < 0) {
+                        break;
+                    }
                 }
             }
+            if (l >= 0) {
+                level[t] = l;
+                num_levels = std::max(num_levels, l + 1);
+                changed = true;
+            }
+        }
+    }
+    for (int t = 0; t < count; t++) {
+        if (level[t] < 0) {
+            level[t] = num_levels;
         }
-        
-        textures.push_back(tex);
+    }
+    
+    std::vector<ttt_texture_t> textures(count);
+    std::vector<int> wave;
+    for (int l = 0; l <= num_levels; l++) {
+        wave.clear();
+        for (int t = 0; t < count; t++) {
+            if (level[t] == l) {
+                wave.push_back(t);
+            }
+        }
+        jobs_parallel_for(static_cast<int>(wave.size()), 1, [&](int begin, int end) {
+            for (int w = begin; w < end; w++) {
+                int t = wave[w];
+                ttt_generate_one(texture_data[t], t, textures[t], textures, level);
+            }
+        });
     }
     
     return textures;
 }
-
-// Include texture data from JS
-#include "textures.h"
-
-void textures_init() {
-    // Generate all textures
-    auto generated_textures = ttt_generate(texture_data);
-    
-    // Create OpenGL textures
-    for (const auto& tex : generated_textures) {
-        r_create_texture(tex.data, tex.width, tex.height);
-        delete[] tex.data;
-    }
-}
\ No newline at end of file
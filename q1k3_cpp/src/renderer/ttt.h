@@ -2,21 +2,23 @@
 #define TTT_H
 
 #include <vector>
-#include <GL/glew.h>
+#include <cstdint>
 
 // TTT (Tiny Texture Tumbler) - Procedural texture generation
 // Ported from JavaScript to C++
 
 struct ttt_texture_t {
-    GLubyte* data;
+    std::vector<uint32_t> pixels;   // RGBA, 8 bits each in this byte order
     int width;
     int height;
 };
 
-// Generate all textures from texture data
+// Generate all textures from texture data, in parallel on the job threads
 std::vector<ttt_texture_t> ttt_generate(const std::vector<std::vector<int>>& texture_data);
 
-// Initialize texture system with procedural textures
+// Initialize texture system with procedural textures: baked into the
+// binary at build time (Q1K3_BAKED_TEXTURES) or generated now
+// (texture.cpp)
 void textures_init();
 
 #endif // TTT_H
\ No newline at end of file
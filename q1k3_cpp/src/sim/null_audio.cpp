@@ -0,0 +1,47 @@
+#include "../game/audio.h"
+
+// Audio for the headless simulation: sounds are never generated or played
+
+void* sfx_shotgun_shoot = nullptr;
+void* sfx_shotgun_reload = nullptr;
+void* sfx_nailgun_shoot = nullptr;
+void* sfx_grenade_shoot = nullptr;
+void* sfx_grenade_explode = nullptr;
+void* sfx_plasma_shoot = nullptr;
+void* sfx_no_ammo = nullptr;
+void* sfx_no_ammo_pickup = nullptr;
+void* sfx_hurt = nullptr;
+void* sfx_pickup = nullptr;
+void* sfx_enemy_hit = nullptr;
+void* sfx_enemy_gib = nullptr;
+void* sfx_zombie_hit = nullptr;
+void* sfx_hound_attack = nullptr;
+
+bool audio_init() {
+    return true;
+}
+
+void audio_cleanup() {
+}
+
+audio_voice_t audio_play(void* /*sound*/, float /*volume*/, float /*pitch*/, float /*pan*/) {
+    return 0;
+}
+
+void audio_stop(audio_voice_t /*voice*/) {
+}
+
+void audio_set_volume(audio_voice_t /*voice*/, float /*volume*/) {
+}
+
+void audio_set_pan(audio_voice_t /*voice*/, float /*pan*/) {
+}
+
+void audio_generate_sounds(bool /*use_cache*/) {
+}
+
+void audio_play_music() {
+}
+
+void audio_stop_music() {
+}
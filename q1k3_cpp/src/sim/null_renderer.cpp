@@ -0,0 +1,77 @@
+#include "../renderer/renderer.h"
+
+// Renderer for the headless simulation. Geometry is only counted, so models
+// and map blocks get the same vertex offsets as with the real renderer.
+
+vec3 r_camera;
+float r_camera_yaw = 0;
+float r_camera_pitch = 0;
+
+int r_num_verts = 0;
+int r_num_indices = 0;
+std::vector<model_t> r_models;
+
+bool r_init() {
+    return true;
+}
+
+void r_cleanup() {
+}
+
+void r_prepare_frame(float /*r*/, float /*g*/, float /*b*/) {
+}
+
+void r_end_frame() {
+}
+
+void r_draw(const vec3& /*pos*/, float /*yaw*/, float /*pitch*/, int /*texture*/,
+            int /*offset*/, int /*num_verts*/) {
+}
+
+void r_draw_model(const vec3& /*pos*/, float /*yaw*/, float /*pitch*/, int /*texture*/,
+                  const model_t* /*model*/, int /*frame1*/, int /*frame2*/, float /*mix*/) {
+}
+
+void r_push_light(const vec3& /*pos*/, float /*intensity*/, float /*r*/, float /*g*/, float /*b*/) {
+}
+
+void r_submit_buffer() {
+}
+
+int r_push_vert(const vec3& /*pos*/, const vec3& /*normal*/, float /*u*/, float /*v*/) {
+    if (r_num_verts >= R_MAX_VERTS) return r_num_verts;
+    return r_num_verts++;
+}
+
+int r_push_index(uint16_t /*index*/) {
+    if (r_num_indices >= R_MAX_INDICES) return r_num_indices;
+    return r_num_indices++;
+}
+
+void r_push_quad(const vec3& v0, const vec3& v1, const vec3& v2, const vec3& v3, float u, float v) {
+    r_push_vert(v0, vec3(), u, 0);
+    r_push_vert(v1, vec3(), 0, 0);
+    r_push_vert(v2, vec3(), u, v);
+    r_push_vert(v3, vec3(), 0, v);
+    r_push_vert(v2, vec3(), u, v);
+    r_push_vert(v1, vec3(), 0, 0);
+}
+
+int r_push_block(float x, float y, float z, float /*sx*/, float /*sy*/, float /*sz*/, int /*texture*/) {
+    int index = r_num_verts;
+    vec3 v(x, y, z);
+    for (int i = 0; i < 6; i++) {
+        r_push_quad(v, v, v, v, 0, 0);
+    }
+    return index;
+}
+
+void r_create_texture(const GLubyte* /*data*/, int /*width*/, int /*height*/) {
+}
+
+model_t* model_get(int index) {
+    if (index >= 0 && index < static_cast<int>(r_models.size())) {
+        return &r_models[index];
+    }
+    return nullptr;
+}
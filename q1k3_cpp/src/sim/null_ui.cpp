@@ -0,0 +1,30 @@
+#include "../game/ui.h"
+
+// UI for the headless simulation: nothing is shown
+
+void UI::init() {
+}
+
+void UI::cleanup() {
+}
+
+void UI::update(float /*delta_time*/) {
+}
+
+void UI::render() {
+}
+
+void UI::show_title_screen(const std::string& /*message*/, const std::string& /*submessage*/) {
+}
+
+void UI::hide_title_screen() {
+}
+
+void UI::show_game_message(const std::string& /*message*/) {
+}
+
+void UI::update_health(int /*health*/) {
+}
+
+void UI::update_ammo(const std::string& /*ammo*/) {
+}
@@ -0,0 +1,135 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include "platform/input.h"
+#include "game/game.h"
+#include "game/demo.h"
+#include "renderer/renderer.h"
+#include "assets/map.h"
+#include "core/jobs.h"
+
+// Headless simulation: runs the game without a window, GL or audio as fast
+// as possible and reports the tick rate. Used for AI/physics throughput
+// numbers and soak tests on machines without a display.
+//
+//   q1k3_sim [--map N] [--seed N] [--ticks N] [--threads N] [--worlds N]
+//            [--play <demo>]
+//
+// With --worlds N, N independent worlds (seeds seed .. seed+N-1) are stepped
+// side by side, one per thread. With --play every world plays the demo
+// (so N worlds check that it replays the same on all threads) and the run
+// ends with the demo unless --ticks is given. Exits with 1 if the demo
+// diverged in any world.
+
+int main(int argc, char* argv[]) {
+    int map_index = 0;
+    uint32_t seed = 1;
+    long max_ticks = -1;
+    int num_threads = 0;
+    int num_worlds = 1;
+    std::string play_path;
+
+    for (int i = 1; i + 1 < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--map") {
+            map_index = std::atoi(argv[++i]);
+        } else if (arg == "--seed") {
+            seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--ticks") {
+            max_ticks = std::atol(argv[++i]);
+        } else if (arg == "--threads") {
+            num_threads = std::atoi(argv[++i]);
+        } else if (arg == "--worlds") {
+            num_worlds = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--play") {
+            play_path = argv[++i];
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    if (!map_load_container("assets/")) {
+        std::cerr << "Failed to load maps!" << std::endl;
+        return -1;
+    }
+    if (map_index < 0 || map_index >= map_count()) {
+        std::cerr << "Invalid map index " << map_index << " (" << map_count() << " maps)" << std::endl;
+        return -1;
+    }
+    
+    // Models are only drawn, the simulation can do without them
+    model_load_container("assets/");
+
+    jobs_init(num_threads);
+
+    // No input device; the players stand still unless a demo is played
+    std::vector<std::unique_ptr<Input>> inputs;
+    std::vector<std::unique_ptr<game_context_t>> worlds;
+    for (int w = 0; w < num_worlds; w++) {
+        inputs.push_back(std::make_unique<Input>());
+        worlds.push_back(std::make_unique<game_context_t>(inputs.back().get()));
+        game_reset(worlds.back().get(), map_index, seed + w);
+    }
+
+    if (!play_path.empty()) {
+        for (auto& world : worlds) {
+            if (!demo_play_start(world.get(), play_path)) {
+                jobs_shutdown();
+                return -1;
+            }
+        }
+    } else if (max_ticks < 0) {
+        max_ticks = 60 * GAME_TICK_RATE;
+    }
+
+    // One world: its update phases use all threads. Many worlds: each one
+    // is stepped on its own thread and updates inline.
+    auto start = std::chrono::steady_clock::now();
+    long ticks = 0;
+    const long batch = num_worlds > 1 ? 60 : 1;
+    auto any_playing = [&worlds]() {
+        return std::any_of(worlds.begin(), worlds.end(),
+                           [](const std::unique_ptr<game_context_t>& world) { return demo_playing(world.get()); });
+    };
+    while (max_ticks < 0 ? any_playing() : ticks < max_ticks) {
+        long n = max_ticks < 0 ? 1 : std::min(batch, max_ticks - ticks);
+        jobs_parallel_for(num_worlds, 1, [&worlds, n](int begin, int end) {
+            for (int w = begin; w < end; w++) {
+                for (long t = 0; t < n; t++) {
+                    game_step(worlds[w].get());
+                }
+            }
+        });
+        ticks += n;
+    }
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    bool diverged = false;
+    for (auto& world : worlds) {
+        diverged |= demo_diverged(world.get());
+        demo_stop(world.get());
+    }
+
+    long world_ticks = ticks * num_worlds;
+    std::cout << "Simulated " << num_worlds << " world(s) x " << ticks << " ticks ("
+              << ticks / GAME_TICK_RATE << "s game time) in " << seconds << "s on "
+              << jobs_num_threads() << " threads" << std::endl;
+    std::cout << "  " << (seconds > 0 ? world_ticks / seconds : 0) << " ticks/s, "
+              << (world_ticks ? seconds * 1e6 / world_ticks : 0) << " us/tick" << std::endl;
+    for (int w = 0; w < std::min(num_worlds, 4); w++) {
+        std::cout << "  world " << w << ": " << worlds[w]->entities.size()
+                  << " entities, checksum " << std::hex << demo_checksum(worlds[w].get())
+                  << std::dec << std::endl;
+    }
+
+    worlds.clear();
+    jobs_shutdown();
+
+    return diverged ? 1 : 0;
+}
@@ -0,0 +1,187 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "game/audio.h"
+#include "core/jobs.h"
+#include "core/random.h"
+
+// Offline audio benchmark: plays a scripted scene through the mixer against
+// a virtual device clock, without an audio device, and reports what the
+// synth and the mixer cost. Everything runs on one thread in device order:
+// the music is topped up, the scene's sounds are started, then one device
+// buffer is mixed. The output goes to a WAV file to listen to.
+//
+//   q1k3_audio_bench [--seconds N] [--rate N] [--block N] [--seed N]
+//                    [--threads N] [--out <file.wav>] [--no-music]
+//
+// --rate is sounds started per second, at random volumes, pans and (for
+// half of them) pitches; --block the device buffer size in frames. Sound
+// effects are rendered without the cache so their synth time is real.
+
+typedef std::chrono::steady_clock bench_clock_t;
+
+static double bench_seconds(bench_clock_t::time_point start) {
+    return std::chrono::duration<double>(bench_clock_t::now() - start).count();
+}
+
+// 16 bit stereo PCM
+static bool bench_write_wav(const std::string& path, const std::vector<float>& samples) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+    
+    auto u32 = [&file](uint32_t v) { file.write(reinterpret_cast<const char*>(&v), 4); };
+    auto u16 = [&file](uint16_t v) { file.write(reinterpret_cast<const char*>(&v), 2); };
+    uint32_t data_size = static_cast<uint32_t>(samples.size() * 2);
+    file.write("RIFF", 4);
+    u32(36 + data_size);
+    file.write("WAVEfmt ", 8);
+    u32(16);
+    u16(1);                         // PCM
+    u16(2);                         // channels
+    u32(AUDIO_SAMPLERATE);
+    u32(AUDIO_SAMPLERATE * 2 * 2);  // bytes per second
+    u16(2 * 2);                     // bytes per frame
+    u16(16);
+    file.write("data", 4);
+    u32(data_size);
+    
+    std::vector<int16_t> pcm(samples.size());
+    for (size_t i = 0; i < samples.size(); i++) {
+        pcm[i] = static_cast<int16_t>(std::lrint(std::clamp(samples[i], -1.0f, 1.0f) * 32767.0f));
+    }
+    file.write(reinterpret_cast<const char*>(pcm.data()), pcm.size() * sizeof(int16_t));
+    if (!file) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    double duration = 60;
+    double rate = 20;
+    int block = 2048;
+    uint32_t seed = 1;
+    int num_threads = 0;
+    bool music = true;
+    std::string out_path = "audio_bench.wav";
+    
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--no-music") {
+            music = false;
+        } else if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return -1;
+        } else if (arg == "--seconds") {
+            duration = std::atof(argv[++i]);
+        } else if (arg == "--rate") {
+            rate = std::atof(argv[++i]);
+        } else if (arg == "--block") {
+            block = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--seed") {
+            seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--threads") {
+            num_threads = std::atoi(argv[++i]);
+        } else if (arg == "--out") {
+            out_path = argv[++i];
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return -1;
+        }
+    }
+    
+    jobs_init(num_threads);
+    
+    auto start = bench_clock_t::now();
+    audio_generate_sounds(false);
+    double synth_sounds_time = bench_seconds(start);
+    
+    void* const sounds[] = {
+        sfx_shotgun_shoot, sfx_shotgun_reload, sfx_nailgun_shoot, sfx_grenade_shoot,
+        sfx_grenade_explode, sfx_plasma_shoot, sfx_no_ammo, sfx_hurt, sfx_pickup,
+        sfx_enemy_hit, sfx_enemy_gib, sfx_hound_attack
+    };
+    const int num_sounds = sizeof(sounds) / sizeof(sounds[0]);
+    
+    if (music) {
+        audio_play_music();
+    }
+    
+    random_t random;
+    random_seed(&random, seed, 0);
+    
+    long total_frames = static_cast<long>(duration * AUDIO_SAMPLERATE);
+    std::vector<float> output(total_frames * 2);
+    double synth_music_time = 0;
+    double mix_time = 0;
+    long music_frames = 0;
+    long voice_frames = 0;
+    long plays = 0;
+    long dropped = 0;     // command queue full
+    long rejected = 0;    // all voices busy with more important sounds
+    long stolen = 0;      // playing sounds cut off for new ones
+    int max_voices = 0;
+    double pending = 0;   // sounds due but not started yet
+    
+    for (long frame = 0; frame < total_frames; frame += block) {
+        int n = static_cast<int>(std::min<long>(block, total_frames - frame));
+        
+        // What the music thread would have done by now
+        if (music) {
+            start = bench_clock_t::now();
+            while (int rendered = audio_music_fill()) {
+                music_frames += rendered;
+            }
+            synth_music_time += bench_seconds(start);
+        }
+        
+        // The scene: what the game would have started during this buffer
+        for (pending += rate * n / AUDIO_SAMPLERATE; pending >= 1; pending--) {
+            void* sound = sounds[random_int(&random, num_sounds)];
+            float volume = random_range(&random, 0.3f, 1.0f);
+            float pan = random_range(&random, -1.0f, 1.0f);
+            float pitch = random_float(&random) < 0.5f ? 0 : random_range(&random, -4.0f, 4.0f);
+            if (audio_play(sound, volume, pitch, pan)) {
+                plays++;
+            } else {
+                dropped++;
+            }
+        }
+        
+        start = bench_clock_t::now();
+        audio_render_stats_t stats;
+        int voices = audio_render(&output[frame * 2], n, &stats);
+        mix_time += bench_seconds(start);
+        rejected += stats.rejected;
+        stolen += stats.stolen;
+        voice_frames += static_cast<long>(voices) * n;
+        max_voices = std::max(max_voices, voices);
+    }
+    
+    std::cout << "Rendered " << duration << "s of audio (" << plays - rejected << " sounds started, up to "
+              << max_voices << " voices at once)" << std::endl;
+    std::cout << "  not started: " << dropped << " (queue full), " << rejected
+              << " (no voice free); cut off for new sounds: " << stolen << std::endl;
+    std::cout << "  synth, sound effects: " << synth_sounds_time * 1e3 << " ms on "
+              << jobs_num_threads() << " threads" << std::endl;
+    std::cout << "  synth, music: " << synth_music_time * 1e3 << " ms ("
+              << (music_frames ? synth_music_time * 1e9 / music_frames : 0) << " ns/frame)" << std::endl;
+    std::cout << "  mixer: " << mix_time * 1e3 << " ms ("
+              << (total_frames ? mix_time * 1e9 / total_frames : 0) << " ns/frame, "
+              << (voice_frames ? mix_time * 1e9 / voice_frames : 0) << " ns/frame/voice)" << std::endl;
+    
+    bool written = bench_write_wav(out_path, output);
+    
+    audio_free_sounds();
+    jobs_shutdown();
+    return written ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include "renderer/ttt.h"
+#include "renderer/textures.h"
+#include "core/jobs.h"
+
+// Build-time texture baker: runs ttt over texture_data and writes the
+// pixels as a header of constant arrays, which texture.cpp compiles in
+// when Q1K3_BAKED_TEXTURES is set. The game then only uploads them.
+//
+//   q1k3_ttt_bake <baked_textures.h>
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: q1k3_ttt_bake <baked_textures.h>" << std::endl;
+        return -1;
+    }
+    
+    jobs_init();
+    auto textures = ttt_generate(texture_data);
+    jobs_shutdown();
+    
+    // Written under a temporary name first, so an interrupted bake never
+    // looks up to date to the build
+    std::string path = argv[1];
+    std::string temp_path = path + ".tmp";
+    std::ofstream file(temp_path);
+    if (!file) {
+        std::cerr << "Failed to open " << temp_path << std::endl;
+        return -1;
+    }
+    
+    file << "// Generated by q1k3_ttt_bake from textures.h, do not edit\n"
+         << "#ifndef BAKED_TEXTURES_H\n"
+         << "#define BAKED_TEXTURES_H\n\n";
+    
+    // Bytes rather than packed pixels, so the result is the same on any
+    // byte order
+    for (size_t t = 0; t < textures.size(); t++) {
+        const ttt_texture_t& tex = textures[t];
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(tex.pixels.data());
+        size_t size = tex.pixels.size() * 4;
+        file << "static const GLubyte ttt_baked_pixels_" << t << "[" << size << "] = {";
+        for (size_t i = 0; i < size; i++) {
+            file << (i == 0 ? "\n    " : i % 32 ? "," : ",\n    ") << static_cast<int>(bytes[i]);
+        }
+        file << "\n};\n\n";
+    }
+    
+    file << "struct ttt_baked_t {\n"
+         << "    int width;\n"
+         << "    int height;\n"
+         << "    const GLubyte* pixels;\n"
+         << "};\n\n"
+         << "static const int ttt_baked_count = " << textures.size() << ";\n"
+         << "static const ttt_baked_t ttt_baked[] = {\n";
+    for (size_t t = 0; t < textures.size(); t++) {
+        file << "    {" << textures[t].width << ", " << textures[t].height
+             << ", ttt_baked_pixels_" << t << "},\n";
+    }
+    file << "};\n\n"
+         << "#endif // BAKED_TEXTURES_H\n";
+    
+    file.close();
+    if (!file) {
+        std::cerr << "Failed to write " << temp_path << std::endl;
+        return -1;
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write " << path << ": " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    
+    std::cout << "Baked " << textures.size() << " textures into " << path << std::endl;
+    return 0;
+}